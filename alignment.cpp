@@ -203,6 +203,30 @@ bool AmrMutation::operator< (const AmrMutation &other) const
 
 
 
+void sortRefMutations (Vector<AmrMutation> &refMutations)
+{
+  refMutations. sort ();
+  
+  bool posSorted = true;
+  FOR_START (size_t, i, 1, refMutations. size ())
+    if (refMutations [i]. pos_real < refMutations [i - 1]. pos_real)
+    {
+      posSorted = false;
+      break;
+    }
+  if (posSorted)
+    return;
+    
+  refMutations. sort ([] (const AmrMutation &a, const AmrMutation &b) 
+                        { LESS_PART (a, b, pos_real);
+                          return a < b;
+                        }
+                     );
+}
+
+
+
+
 // SeqChange
 
 void SeqChange::qc () const
@@ -350,15 +374,10 @@ void SeqChange::setStartStopRef ()
   ASSERT (al);
   ASSERT (start < al->qseq. size ());
   
-  start_ref = al->qInt. start;
-  FOR (size_t, i, start)
-    if (al->qseq [i] != '-')
-      start_ref += al->a2q;
-      
-  stop_ref = start_ref;
-  FOR_START (size_t, i, start, start + len)
-    if (al->qseq [i] != '-')
-      stop_ref += al->a2q;
+  ASSERT (al->qResidues. size () == al->qseq. size () + 1);
+  
+  start_ref = al->qInt. start + al->qResidues [start] * al->a2q;
+  stop_ref  = al->qInt. start + al->qResidues [start + len] * al->a2q;
 }
 
 
@@ -368,19 +387,13 @@ void SeqChange::setStartTarget ()
   ASSERT (al);
   ASSERT (start < al->sseq. size ());
   
+  ASSERT (al->sResidues. size () == al->sseq. size () + 1);
+  
   start_target = al->sInt. start;
   if (al->sInt. strand == 1)
-  {
-    FOR (size_t, i, start)
-      if (al->sseq [i] != '-')
-        start_target += al->a2s;
-  }
+    start_target += al->sResidues [start] * al->a2s;
   else
-  {
-    FOR_REV_END (size_t, i, start + len, al->sseq. size ())
-      if (al->sseq [i] != '-')
-        start_target += al->a2s;
-  }  
+    start_target += (al->sResidues. back () - al->sResidues [start + len]) * al->a2s;
 }
 
 
@@ -474,9 +487,40 @@ bool SeqChange::matchesMutation (const AmrMutation& mut) const
 
 // Alignment
 
+void Alignment::setResidues ()
+{
+  ASSERT (qseq. size () == sseq. size ());
+  
+  qResidues. clear ();
+  sResidues. clear ();
+  qResidues. reserve (qseq. size () + 1);
+  sResidues. reserve (sseq. size () + 1);
+  qResidues << 0;
+  sResidues << 0;
+  FFOR (size_t, i, qseq. size ())
+  {
+    qResidues << qResidues. back () + (qseq [i] != '-');
+    sResidues << sResidues. back () + (sseq [i] != '-');
+  }
+}
+
+
+
 void Alignment::setSeqChanges (const Vector<AmrMutation> &refMutations,
                                size_t flankingLen/*,
                                bool allMutationsP*/)
+{
+  setResidues ();
+  setSeqChanges_ (refMutations, flankingLen);
+  // Free memory
+  qResidues = Vector<size_t> ();
+  sResidues = Vector<size_t> ();
+}
+
+
+
+void Alignment::setSeqChanges_ (const Vector<AmrMutation> &refMutations,
+                                size_t flankingLen)
 {
   ASSERT (seqChanges. empty ());
   ASSERT (! refMutations. empty ());  	
@@ -521,28 +565,20 @@ void Alignment::setSeqChanges (const Vector<AmrMutation> &refMutations,
 
   
   {
-	  SeqChange seqChange (this/*, false*/);
-	  bool inSeqChange = false;
-		FFOR (size_t, i, qseq. size () + 1)
-		  if (inSeqChange)
-		  {
-        if (sseq [i] == qseq [i])
-        {
-          if (seqChange. finish (qseq, flankingLen))            
-            seqChanges << std::move (seqChange);
-          seqChange = SeqChange (this/*, false*/);
-          inSeqChange = false;
-        }
-        else
-          seqChange. len++;
-      }
-      else
-        if (sseq [i] != qseq [i])
-        {
-          seqChange. start = i;
-          seqChange. len = 1;
-          inSeqChange = true;
-        }
+    size_t i = 0;
+    for (;;)
+    {
+      i = seqMismatch (qseq, sseq, i);
+      if (i == qseq. size ())
+        break;
+      SeqChange seqChange (this/*, false*/);
+      seqChange. start = i;
+      while (i < qseq. size () && sseq [i] != qseq [i])
+        i++;
+      seqChange. len = i - seqChange. start;
+      if (seqChange. finish (qseq, flankingLen))            
+        seqChanges << std::move (seqChange);
+    }
   }
 #if 0
   if (   sProt 
@@ -562,15 +598,18 @@ void Alignment::setSeqChanges (const Vector<AmrMutation> &refMutations,
   }
 
   
+  // refMutations are sorted by pos_real
+  const auto mutationStart = [&refMutations] (size_t pos) -> size_t
+    { return (size_t) (std::lower_bound (refMutations. begin (), refMutations. end (), pos, 
+                                         [] (const AmrMutation &mut, size_t pos_) { return mut. pos_real < pos_; }
+                                        ) 
+                       - refMutations. begin ()
+                      ); 
+    };
+
+  
 //Vector<SeqChange> seqChanges_add;
-	size_t j = 0;
-	
-  while (j < refMutations. size () && refMutations [j]. pos_real < qInt. start)
-  {
-  //if (allMutationsP)
-  	//seqChanges_add << SeqChange (this, & refMutations [j]);
-    j++;
-  }
+	size_t j = mutationStart (qInt. start);
   
   // SeqChange::mutations
 	size_t start_ref_prev = no_index;
@@ -580,6 +619,8 @@ void Alignment::setSeqChanges (const Vector<AmrMutation> &refMutations,
     if (verbose ())
       seqChange. saveText (cout);
     IMPLY (start_ref_prev != no_index, start_ref_prev <= seqChange. start_ref);
+    // AmrMutation's before seqChange.start_ref do not match
+    maximize (j, mutationStart (seqChange. start_ref));
     while (j < refMutations. size ())
     {
 		  const AmrMutation& mut = refMutations [j];
@@ -632,8 +673,11 @@ void Alignment::setSeqChanges (const Vector<AmrMutation> &refMutations,
     size_t i = 0;
     if (verbose ())
       cout << "refMutations: " << refMutations. size () << endl;
-    for (const AmrMutation& mut : refMutations)
+    FOR_START (size_t, k, mutationStart (qInt. start), refMutations. size ())
     {
+      const AmrMutation& mut = refMutations [k];
+      if (mut. pos_real >= qInt. stop)
+        break;
       while (refPos < mut. pos_real)
       {
         ASSERT (qseq [i] != '-');
@@ -647,8 +691,8 @@ void Alignment::setSeqChanges (const Vector<AmrMutation> &refMutations,
       if (! qseq [i])
         break;
       if (   refPos == mut. pos_real
-          && isLeft (string (& qseq [i]), mut. reference)
-          && isLeft (string (& sseq [i]), mut. reference)
+          && ! qseq. compare (i, mut. reference. size (), mut. reference)
+          && ! sseq. compare (i, mut. reference. size (), mut. reference)
          )
     	  seqChanges << SeqChange (this, & mut);
     }
@@ -759,6 +803,65 @@ void Alignment::qc () const
 }
 
 
+// SeqChangeIndex
+
+bool SeqChangeIndex::Item::operator< (const Item &other) const
+{
+  LESS_PART (*this, other, al->sProt);
+  LESS_PART (*this, other, al->sseqid);
+  LESS_PART (*this, other, al->sInt. strand);
+  LESS_PART (*this, other, seqChange->start_target);
+  return false;
+}
+
+
+
+void SeqChangeIndex::add (Alignment &al)
+{
+  ASSERT (! finished);
+  
+  for (SeqChange& seqChange : al. seqChanges)
+  {
+    ASSERT (seqChange. al == & al);
+    items << Item {& seqChange, & al};
+  }
+}
+
+
+
+void SeqChangeIndex::setReplacements (bool sameFrameshift)
+{
+  ASSERT (! finished);
+  
+  // SeqChange::hasFrameshift() and SeqChange::better() depend on SeqChange::replacement => the order of add() is preserved within a key
+  std::stable_sort (items. begin (), items. end ());
+  finished = true;
+
+  size_t start = 0;
+  while (start < items. size ())
+  {
+    size_t stop = start + 1;
+    while (stop < items. size () && items [start]. sameKey (items [stop]))
+      stop++;
+    FOR_START (size_t, i, start, stop)
+    {
+      const SeqChange& seqChange1 = * items [i]. seqChange;
+      FOR_START (size_t, j, start, stop)
+      {
+        if (items [j]. al == items [i]. al)
+          continue;
+        SeqChange& seqChange2 = * items [j]. seqChange;
+        if (   (! sameFrameshift || seqChange1. hasFrameshift () == seqChange2. hasFrameshift ())
+            && seqChange1. better (seqChange2)
+           )
+          seqChange2. replacement = & seqChange1;
+      }
+    }
+    start = stop;
+  }
+}
+
+
 
 }  // namespace
 
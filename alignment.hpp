@@ -134,6 +134,13 @@ public:
 
 
 
+void sortRefMutations (Vector<AmrMutation> &refMutations);
+  // Output: refMutations: sorted by AmrMutation::pos_real, then by AmrMutation::operator<()
+  //         Same as sort() if the AmrMutation::gene's are the same
+  // Invoked once per reference accession after the mutation table is read
+
+
+
 struct Alignment;
 
 
@@ -242,6 +249,13 @@ struct Alignment : Hsp
 
   Vector<SeqChange> seqChanges;
 
+  // Valid during setSeqChanges()
+  Vector<size_t> qResidues;
+    // size() = qseq.size() + 1
+    // [i] = number of non-'-' in qseq[0,i)
+  Vector<size_t> sResidues;
+    // Cf. qResidues
+
   
   Alignment (const string &line,
              bool qProt_arg,  
@@ -253,8 +267,14 @@ protected:
   void setSeqChanges (const Vector<AmrMutation> &refMutations,
                       size_t flankingLen/*,
                       bool allMutationsP*/);
-    // Input: flankingLen: valid if > 0
+    // Input: refMutations: sorted by AmrMutation::pos_real, see sortRefMutations()
+    //        flankingLen: valid if > 0
+    // Time: O(qseq.size() + log(refMutations.size()) + number of refMutations in qInt)
 private:
+  void setSeqChanges_ (const Vector<AmrMutation> &refMutations,
+                       size_t flankingLen);
+  void setResidues ();
+    // Output: qResidues, sResidues
   size_t refMutation2refSeq_pos ();
     // Return: no_index <=> refMutation is not detected
 public:
@@ -279,6 +299,40 @@ public:
 
 
 
+struct SeqChangeIndex
+// SeqChange's competing for the same target position
+// Key: Alignment::sProt, Alignment::sseqid, Alignment::sInt.strand, SeqChange::start_target
+{
+private:
+  struct Item
+  {
+    SeqChange* seqChange {nullptr};
+      // !nullptr
+    const Alignment* al {nullptr};
+      // = seqChange->al
+    bool operator< (const Item &other) const;
+      // Key order
+    bool sameKey (const Item &other) const
+      { return ! (*this < other) && ! (other < *this); }
+  };
+  Vector<Item> items;
+    // Stable-sorted by key by setReplacements()
+  bool finished {false};
+public:
+
+
+  void add (Alignment &al);
+    // Adds al.seqChanges
+    // Requires: !finished
+  void setReplacements (bool sameFrameshift);
+    // Output: SeqChange::replacement
+    //         Same result as comparing all pairs of the add()'ed SeqChange's of different Alignment's in the order of add()
+    // Input: sameFrameshift: SeqChange::hasFrameshift() must be equal
+    // Time: O(n log(n) + sum_key n_key^2)
+};
+
+
+
 
 }  // namespace
 
@@ -364,6 +364,10 @@
 #undef NDEBUG 
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <condition_variable>
+#include <chrono>
 
 #include "common.hpp"
 #include "tsv.hpp"
@@ -372,6 +376,8 @@ using namespace Common_sp;
 using namespace GFF_sp;
 #include "seq.hpp"
 #include "columns.hpp"
+#include "amrreport.hpp"
+using namespace AmrReport_sp;
 
 #include "common.inc"
 
@@ -399,9 +405,6 @@ namespace
 // PAR
 //constexpr size_t threads_max_min = 1;  
 constexpr size_t threads_def = 4;
-// Cf. amr_report.cpp
-constexpr double ident_min_def = 0.9;
-constexpr double partial_coverage_min_def = 0.5;
 const string ambigS ("20");  
 
 
@@ -438,6 +441,904 @@ int amrTab_equivBetter (const void* rowBetter,
 
 
 
+
+struct Stage
+// Node of StageGraph
+{
+  string name;
+  size_t cpu {1};
+    // CPU tokens held while running
+  function<void ()> func;
+  Vector<size_t> prerequisites;
+    // Indexes in StageGraph::stages
+};
+
+
+
+struct StageGraph
+// Dependency graph of Stage's run concurrently within a budget of CPU tokens
+{
+private:
+  Vector<Stage> stages;
+  const size_t cpu_max;
+public:
+
+
+  explicit StageGraph (size_t cpu_max_arg)
+    : cpu_max (max<size_t> (cpu_max_arg, 1))
+    {}
+
+
+  size_t add (const string &name,
+              size_t cpu,
+              const function<void ()> &func,
+              const Vector<size_t> &prerequisites = Vector<size_t> ())
+    // Return: index of the new Stage
+    { ASSERT (! name. empty ());
+      ASSERT (func);
+      for (const size_t i : prerequisites)
+        QC_ASSERT (i < stages. size ());
+      stages << Stage {name, max<size_t> (min (cpu, cpu_max), 1), func, prerequisites};
+      return stages. size () - 1;
+    }
+  bool empty () const
+    { return stages. empty (); }
+  void run ();
+    // Stage's are started in the order of add() as soon as their prerequisites are finished and CPU tokens are available
+    // Rethrows the first exception thrown by a Stage after all running Stage's finish
+};
+
+
+
+void StageGraph::run ()
+{
+  enum Status {waiting, running, finished};
+  vector<Status> status (stages. size (), waiting);
+  size_t cpu_free = cpu_max;
+  size_t running_num = 0;
+  exception_ptr error;
+  mutex mtx;
+  condition_variable cv;
+  vector<thread> threads;
+  threads. reserve (stages. size ());
+  {
+    unique_lock<mutex> lock (mtx);
+    for (;;)
+    {
+      if (! error)
+        FFOR (size_t, i, stages. size ())
+        {
+          if (status [i] != waiting)
+            continue;
+          const Stage& stage = stages [i];
+          bool ready = true;
+          for (const size_t j : stage. prerequisites)
+            if (status [j] != finished)
+            {
+              ready = false;
+              break;
+            }
+          if (! ready)
+            continue;
+          if (stage. cpu > cpu_free)
+            continue;
+          cpu_free -= stage. cpu;
+          status [i] = running;
+          running_num++;
+          threads. push_back (thread ([this, i, &status, &cpu_free, &running_num, &error, &mtx, &cv] ()
+            { exception_ptr e;
+              try { stages [i]. func (); }
+                catch (...) { e = current_exception (); }
+              const lock_guard<mutex> lg (mtx);
+              status [i] = finished;
+              cpu_free += stages [i]. cpu;
+              running_num--;
+              if (e && ! error)
+                error = e;
+              cv. notify_one ();
+            }));
+        }
+      if (! running_num)
+        break;
+      cv. wait (lock);
+    }
+  }
+
+  for (thread& t : threads)
+    t. join ();
+  if (error)
+    rethrow_exception (error);
+
+  FFOR (size_t, i, stages. size ())
+    if (status [i] != finished)
+      throw logic_error ("Stage " + strQuote (stages [i]. name) + " cannot be started: circular prerequisites");
+}
+
+
+
+Vector<size_t> splitThreads (const Vector<size_t> &requested,
+                             size_t total)
+// Return: number of threads for each requested[i], >= 1
+//         Equal shares of total, a share is limited by requested[i] and the rest is redistributed
+{
+  Vector<size_t> res (requested. size (), 1);
+  if (requested. empty ())
+    return res;
+  size_t rest = total > requested. size () ? total - requested. size () : 0;
+  for (;;)
+  {
+    size_t hungry = 0;
+    FFOR (size_t, i, requested. size ())
+      if (res [i] < requested [i])
+        hungry++;
+    if (! hungry || ! rest)
+      break;
+    const size_t share = max<size_t> (rest / hungry, 1);
+    FFOR (size_t, i, requested. size ())
+      if (rest && res [i] < requested [i])
+      {
+        const size_t add = min (min (share, requested [i] - res [i]), rest);
+        res [i] += add;
+        rest -= add;
+      }
+  }
+  return res;
+}
+
+
+
+size_t searchChunks (const string &fastaFName,
+                     size_t workers,
+                     const string &chunkDir,
+                     const function<void (size_t chunk, const string &chunkFName)> &search)
+// Dynamic dispatch of the sequences of fastaFName by chunks to workers which run search() concurrently
+// A chunk is taken by the first free worker
+// Chunk size: the first chunks are a fraction of the total sequence length,
+//             then the sequence length searched in chunk_sec by the measured speed,
+//             not greater than the rest of the sequences per worker 
+// Input: fastaFName: unquoted
+// Output: chunkDir/<chunk>, chunk = 1..Return, in the order of fastaFName
+// Return: number of chunks
+// Rethrows the first exception of search() after all running search()'es finish
+{
+  // PAR
+  constexpr size_t chunks_per_worker = 8;  
+  constexpr double chunk_sec = 5.0;
+  constexpr size_t chunk_min = 1000;  // Sequence length
+  
+  ASSERT (workers);
+  ASSERT (search);
+
+  StringVector records;
+  Vector<size_t> sizes;
+  size_t total = 0;
+  {
+    LineInput f (fastaFName);
+    while (f. nextLine ())
+    {
+      trimTrailing (f. line);
+      if (f. line. empty ())
+        continue;
+      if (f. line [0] == '>' || records. empty ())
+      {
+        records << noString;
+        sizes << 0;
+      }
+      records. back () += f. line + '\n';
+      if (f. line [0] != '>')
+      {
+        sizes. back () += f. line. size ();
+        total += f. line. size ();
+      }
+    }
+  }
+  
+  const size_t chunk_init = max<size_t> (total / (workers * chunks_per_worker), chunk_min);
+  mutex mtx;
+  size_t next = 0;
+  size_t chunks = 0;
+  size_t rest = total;
+  // Measured speed
+  double len_done = 0.0;
+  double sec_done = 0.0;
+  exception_ptr error;
+  const auto worker = [&] () 
+    { for (;;)
+      {
+        size_t chunk = 0;
+        size_t start = 0;
+        size_t end = 0;
+        size_t len = 0;
+        {
+          const lock_guard<mutex> lg (mtx);
+          if (error || next == records. size ())
+            return;
+          size_t len_max = sec_done > 0.0 ? (size_t) (len_done / sec_done * chunk_sec) : chunk_init;
+          minimize (len_max, rest / workers);
+          maximize (len_max, chunk_min);
+          start = next;
+          while (next < records. size () && (next == start || len + sizes [next] <= len_max))
+          {
+            len += sizes [next];
+            next++;
+          }
+          end = next;
+          rest -= len;
+          chunks++;
+          chunk = chunks;
+        }
+        const string chunkFName (chunkDir + "/" + to_string (chunk));
+        const auto time_start = chrono::steady_clock::now ();
+        try 
+        {
+          {
+            OFStream f (chunkFName);
+            FOR_START (size_t, i, start, end)
+              f << records [i];
+          }
+          search (chunk, chunkFName);
+        }
+        catch (...)
+        {
+          const lock_guard<mutex> lg (mtx);
+          if (! error)
+            error = current_exception ();
+          return;
+        }
+        const chrono::duration<double> sec = chrono::steady_clock::now () - time_start;
+        const lock_guard<mutex> lg (mtx);
+        len_done += (double) len;
+        sec_done += sec. count ();
+      }
+    };
+
+  {
+    vector<thread> threads;  threads. reserve (workers);
+    FFOR (size_t, i, workers)
+      threads. push_back (thread (worker));
+    for (thread& t : threads)
+      t. join ();
+  }
+  if (error)
+    rethrow_exception (error);
+    
+  return chunks;
+}
+
+
+
+void concatChunks (const string &dirName,
+                   size_t chunks,
+                   const string &outFName)
+// Input: dirName/<chunk>, chunk = 1..chunks
+{
+  OFStream f (outFName);
+  FOR_START (size_t, i, 1, chunks + 1)
+    copyText (dirName + "/" + to_string (i), 0, f);
+}
+
+
+
+struct Sample
+// Input genome
+{
+  // Quoted
+  string name;
+  string prot;
+  string dna;
+  string gff;
+  string organism;
+  // Output files
+  string output;
+    // empty() <=> cout
+  string mutation_all;
+    // empty() <=> no report
+
+  string dir;
+    // Temporary directory
+  string sub;
+    // dir = tmp + "/" + sub without the trailing '/'
+
+  // Quoted
+  string prot_flat;
+  string dna_flat;
+  string gff_flat;
+  string prot1;
+    // Protein FASTA with no dashes in the sequences
+
+  string organism1;
+  bool suppress_common {false};
+  bool blastn {false};
+  bool stxTyper {false};
+  Gff::Type gffType {Gff::genbank};
+  AmrReport amrReportPar;
+    // Sample-specific parameters
+  AmrReportResult amrReportRes;
+
+  // Searches
+  bool protSearch {false};
+  size_t nProt {0};
+  size_t protLen_total {0};
+  string blastx;
+    // "blastx" or "tblastn"
+  size_t nDna {0};
+  size_t dnaLen_total {0};
+  bool slowBlastx {false};
+  // Searches are done in a packed run of several samples
+  bool protPacked {false};
+  bool blastxPacked {false};
+};
+
+
+
+void parm2amrReport (const string &parm,
+                     AmrReport &par)
+// Input: parm: amr_report parameters for testing
+// Update: par
+{
+  for (const string& p : StringVector (parm, ' ', true))
+    if (p. empty ())
+      continue;
+    else if (p == "-nosame")          par. nosame         = true;
+    else if (p == "-noblast")         par. noblast        = true;
+    else if (p == "-nohmm")           par. nohmm          = true;
+    else if (p == "-skip_hmm_check")  par. skip_hmm_check = true;
+    else if (p == "-retain_blasts")   par. retainBlasts   = true;
+    else if (p == "-non_reportable")  par. non_reportable = true;
+    else if (p == "-print_node_raw")  par. print_node_raw = true;
+    else if (p == "-bed")             par. bedP           = true;
+    else if (p == "-pareto_ungrouped") par. paretoUngrouped = true;
+    else
+      throw runtime_error ("Unknown amr_report parameter in --parm: " + strQuote (p));
+}
+
+
+
+void addRows (TextTable &tab,
+              const string &fName)
+// Input: fName: table with the columns of tab, or empty file
+// Update: tab
+{
+  if (! getFileSize (fName))
+    return;
+  TextTable other (fName);
+  if (other. header. size () != tab. header. size ())
+    throw runtime_error ("Table " + strQuote (fName) + " has " + to_string (other. header. size ()) + " columns whereas " + to_string (tab. header. size ()) + " columns are expected");
+  if (other. rows. empty ())
+    return;
+  tab. rows << std::move (other. rows);
+  tab. setHeader ();
+}
+
+
+
+// Packing of the sequences of several samples into one search
+// Packed sequence identifier: <sample number in the pack> packDelim <sequence identifier>
+constexpr char packDelim = '~';
+
+
+
+template <typename Func>
+  void forEachSeq (const string &fName,
+                   Func func)
+  // Invokes: func(id,seq,record)
+  //   id: first word of the FASTA header
+  //   record: FASTA lines of the sequence
+  { LineInput f (fName);
+    string id;
+    string seq;
+    string record;
+    for (;;)
+    {
+      const bool eof = ! f. nextLine ();
+      if (eof || isLeft (f. line, ">"))
+      {
+        if (! record. empty ())
+          func (id, seq, record);
+        seq. clear ();
+        record. clear ();
+        if (eof)
+          break;
+        id = f. line. substr (1);
+        id = findSplit (id);
+      }
+      else
+        seq += f. line;
+      record += f. line + "\n";
+    }
+  }
+
+
+
+bool packable (const string &fName)
+// Return: sequence identifiers of fName are not parsed by BLAST, and BLAST output can be demultiplexed
+{
+  LineInput f (unQuote (fName));
+  while (f. nextLine ())
+    if (isLeft (f. line, ">"))
+    {
+      const size_t end = f. line. find_first_of (" \t");
+      if (f. line. substr (0, end). find ('|') != string::npos)
+        return false;
+    }
+  return true;
+}
+
+
+
+constexpr size_t blastxDnaLen_max = 100000;  // PAR  // SB-3643
+  // Longer contigs are searched by tblastn, or by blastx in DnaWindow's
+
+
+
+struct DnaWindow
+// Part of a contig searched separately
+{
+  string contig;
+  size_t contigLen {0};
+  size_t start {0};
+    // In contig
+  // Hits starting in [own_start, own_end) are reported from this window
+  size_t own_start {0};
+  size_t own_end {0};
+};
+
+
+
+Vector<DnaWindow> dna2windows (const string &inFName,
+                               size_t window_len,
+                               size_t overlap,
+                               const string &outFName)
+// Contigs longer than window_len are split into windows of length window_len overlapping by overlap
+// The owned intervals of the windows of a contig partition the contig, so a hit is owned by exactly one window
+// A hit not longer than overlap / 2 is in its owning window completely
+// Requires: window_len > overlap, overlap is even
+// Input: inFName: DNA FASTA, unquoted
+// Output: outFName: FASTA of the windows with identifiers "w<index in Return>"
+// Return: windows in the order of inFName
+{
+  ASSERT (window_len > overlap);
+  ASSERT (overlap % 2 == 0);
+  
+  Vector<DnaWindow> windows;
+  OFStream f (outFName);
+  forEachSeq (inFName, [&] (const string &id, const string &seq, const string &/*record*/)
+    { size_t start = 0;
+      for (;;)
+      {
+        const bool last = start + window_len >= seq. size ();
+        DnaWindow w;
+        w. contig    = id;
+        w. contigLen = seq. size ();
+        w. start     = start;
+        w. own_start = start ? start + overlap / 2 : 0;
+        w. own_end   = last ? seq. size () : start + window_len - overlap / 2;
+        QC_ASSERT (w. own_start < w. own_end);
+        QC_ASSERT (! start || windows. back (). own_end == w. own_start);
+        f << ">w" << windows. size () << '\n' 
+          << seq. substr (start, last ? seq. size () - start : window_len) << '\n';
+        windows << std::move (w);
+        if (last)
+          break;
+        start += window_len - overlap;
+      }
+    });
+  return windows;
+}
+
+
+
+bool blastxWindow2contig (string &line,
+                          const Vector<DnaWindow> &windows)
+// Update: line: in Seq_sp::Hsp::format [false] where qseqid = "w<index in windows>", 
+//               qseqid, qstart, qend, qlen are replaced by the contig values
+// Return: the window owns the hit
+{
+  StringVector fields (line, '\t', false);
+  QC_ASSERT (fields. size () == 10);
+  QC_ASSERT (isLeft (fields [1], "w"));
+  const size_t i = str2<size_t> (fields [1]. substr (1));
+  QC_ASSERT (i < windows. size ());
+  const DnaWindow& w = windows [i];
+  const size_t qstart = str2<size_t> (fields [5]) + w. start;
+  const size_t qend   = str2<size_t> (fields [6]) + w. start;
+  QC_ASSERT (qstart);
+  QC_ASSERT (qend);
+  if (! between (min (qstart, qend) - 1, w. own_start, w. own_end))
+    return false;
+  fields [1] = w. contig;
+  fields [5] = to_string (qstart);
+  fields [6] = to_string (qend);
+  fields [7] = to_string (w. contigLen);
+  line = fields. toString ("\t");
+  return true;
+}
+
+
+
+void packFasta (const VectorPtr<Sample> &samples,
+                bool prot,
+                const string &outFName)
+// Input: samples: in the order of sample numbers
+{
+  OFStream out (outFName);
+  FFOR (size_t, i, samples. size ())
+  {
+    const Sample& s = * samples [i];
+    LineInput f (unQuote (prot ? s. prot1 : s. dna_flat));
+    while (f. nextLine ())
+      if (isLeft (f. line, ">"))
+        out << '>' << i << packDelim << f. line. substr (1) << '\n';
+      else
+        out << f. line << '\n';
+  }
+}
+
+
+
+void demultiplex (const string &packedFName,
+                  bool blast,
+                  const VectorPtr<Sample> &samples,
+                  const string &outName)
+// Input: packedFName: lines of BLAST output with the packed sequence identifier in the 2nd field if blast,
+//                     hmmsearch table with the packed sequence identifier in the 1st field otherwise
+//        samples: as in packFasta()
+// Output: <Sample::dir>/outName with the sample sequence identifiers
+{
+  vector<unique_ptr<OFStream>> outs;  outs. reserve (samples. size ());
+  for (const Sample* s : samples)
+    outs. push_back (unique_ptr<OFStream> (new OFStream (s->dir + "/" + outName)));
+  LineInput f (packedFName);
+  while (f. nextLine ())
+  {
+    if (   ! blast
+        && (f. line. empty () || f. line [0] == '#')
+       )
+      continue;
+    size_t start = 0;
+    if (blast)
+    {
+      start = f. line. find ('\t');
+      QC_ASSERT (start != string::npos);
+      start++;
+    }
+    const size_t delim = f. line. find (packDelim, start);
+    QC_ASSERT (delim != string::npos);
+    const size_t sampleNum = str2<size_t> (f. line. substr (start, delim - start));
+    QC_ASSERT (sampleNum < outs. size ());
+    f. line. erase (start, delim + 1 - start);
+    *outs [sampleNum] << f. line << '\n';
+  }
+}
+
+
+
+struct ProtDedup
+// Identical sequences of a FASTA file
+{
+  StringVector ids;
+    // In the FASTA order
+  unordered_map<string/*id*/,string/*id*/> id2rep;
+    // Representative id: first id of the identical sequences
+  unordered_map<string/*id*/,StringVector/*ids*/> rep2ids;
+    // StringVector: in the FASTA order
+    
+    
+  explicit ProtDedup (const string &fName)
+    { unordered_map<string/*sequence*/,string/*id*/> seq2rep;
+      forEachSeq (fName, [&] (const string &id, const string &seq, const string &/*record*/)
+                           { const auto it = seq2rep. insert ({seq, id});
+                             id2rep [id] = it. first->second;
+                             rep2ids [it. first->second] << id;
+                             ids << id;
+                           }
+                 );
+      QC_ASSERT (id2rep. size () == ids. size ());
+    }
+  bool redundant () const
+    { return rep2ids. size () < ids. size (); }
+  size_t saveUniq (const string &fName,
+                   const string &uniqFName) const
+    // Return: number of sequences in uniqFName
+    // Input: fName: as in ProtDedup()
+    // Output: uniqFName: sequences of fName with representative id's
+    { OFStream out (uniqFName);
+      forEachSeq (fName, [&] (const string &id, const string &/*seq*/, const string &record)
+                           { if (id2rep. at (id) == id)
+                               out << record; 
+                           }
+                 );
+      return rep2ids. size ();
+    }
+  void fanOut (const string &inFName,
+               bool blast,
+               const string &outFName) const
+    // Input: inFName: lines of BLAST output with a representative id in the 2nd field if blast,
+    //                 hmmsearch table with a representative id in the 1st field otherwise
+    // Output: outFName: the lines of inFName for all ids
+    //           BLAST output: in the order of ids
+    //           hmmsearch table: lines are repeated for the ids of their representative id
+    { OFStream out (outFName);
+      unordered_map<string/*id*/,StringVector/*lines*/> rep2lines;
+      LineInput f (inFName);
+      while (f. nextLine ())
+      {
+        if (   ! blast
+            && (f. line. empty () || f. line [0] == '#')
+           )
+        {
+          out << f. line << '\n';
+          continue;
+        }
+        size_t start = 0;
+        if (blast)
+        {
+          start = f. line. find ('\t');
+          QC_ASSERT (start != string::npos);
+          start++;
+        }
+        size_t end = f. line. find_first_of (blast ? "\t" : " \t", start);
+        if (end == string::npos)
+          end = f. line. size ();
+        const string rep (f. line. substr (start, end - start));
+        const StringVector* repIds = findPtr (rep2ids, rep);
+        if (! repIds)
+          throw runtime_error ("Unknown sequence id in " + strQuote (inFName) + ":\n" + f. line);
+        if (blast)
+          rep2lines [rep] << f. line;
+        else
+          for (const string& id : *repIds)
+            out << f. line. substr (0, start) << id << f. line. substr (end) << '\n';
+      }
+      if (blast)
+        for (const string& id : ids)
+          if (const StringVector* lines = findPtr (rep2lines, id2rep. at (id)))
+            for (const string& line : *lines)
+            {
+              const size_t start = line. find ('\t') + 1;
+              out << line. substr (0, start) << id << line. substr (line. find ('\t', start)) << '\n';
+            }
+    }
+};
+
+
+
+// Search results of a protein without the protein id:
+//   BLAST line: empty 2nd field
+//   hmmsearch table line: no 1st field, prefixed by 'T' (--tblout) or 'D' (--domtblout)
+
+inline string blastLine_removeId (const string &line,
+                                  string &id)
+  { const size_t start = line. find ('\t') + 1;
+    const size_t end = line. find ('\t', start);
+    QC_ASSERT (start && end != string::npos);
+    id = line. substr (start, end - start);
+    return line. substr (0, start) + line. substr (end);
+  }
+
+inline string blastLine_insertId (const string &line,
+                                  const string &id)
+  { const size_t start = line. find ('\t') + 1;
+    return line. substr (0, start) + id + line. substr (start);
+  }
+
+
+
+struct ExactIndex
+// Proteins identical to AMRProt.fa proteins, for which BLAST is not run
+// Made by amrfinder_index
+{
+  unordered_map<string/*sequence*/,StringVector/*BLAST sseqid*/> seq2refs;
+    // StringVector: in the BLAST order
+  
+  
+  explicit ExactIndex (const string &fName)
+    { if (! fileExists (fName))
+        return;
+      LineInput f (fName);
+      while (f. nextLine ())
+      {
+        string seq (f. line);
+        string sseqid (rfindSplit (seq, '\t'));
+        QC_ASSERT (! seq. empty ());
+        QC_ASSERT (! sseqid. empty ());
+        seq2refs [seq] << std::move (sseqid);
+      }
+    }
+  bool empty () const
+    { return seq2refs. empty (); }
+    
+    
+  bool get (const string &seq,
+            StringVector &lines) const
+    // Return: seq is in seq2refs
+    // Output: lines: BLAST lines without the protein id, if Return
+    { const StringVector* sseqids = findPtr (seq2refs, seq);
+      if (! sseqids)
+        return false;
+      const string len (to_string (seq. size ()));
+      lines. clear ();
+      for (const string& sseqid : *sseqids)
+        lines << (sseqid + "\t\t1\t" + len + "\t" + len + "\t1\t" + len + "\t" + len + "\t" + seq + "\t" + seq);
+      return true;
+    }
+};
+
+
+
+struct HitCache
+// Persistent cache of the blastp and hmmsearch results of proteins
+// A shard per <search> and <hash> % 256, <hash> = str_hash() of a protein sequence:
+//   <dir>/<search>/<shard>.dat: append-only records: <sequence> <eol> <number of lines> <eol> {<search result without the protein id> <eol>}*
+//   <dir>/<search>/<shard>.idx: lines "<hash in hex> <offset of a record in .dat>", replaced atomically
+// Writers append records and replace the index under flock() of .dat, readers do not lock: an index refers to complete records only
+// Several processes can share a cache
+{
+private:
+  string dir;
+  typedef  unordered_multimap<size_t/*hash*/,streamoff/*in .dat*/>  Index;
+  mutable mutex mtx;
+    // Protects shard2index
+  mutable unordered_map<string/*shard*/,Index> shard2index;
+    // Loaded on demand
+public:
+  
+
+  HitCache (const string &root,
+            const string &scope)
+    : dir (root + "/" + scope)
+    { std::filesystem::create_directories (dir); }
+    
+    
+private:
+  string getShard (const string &search,
+                   size_t hash) const
+    // Return: path without extension
+    { ostringstream oss;
+      oss << dir << '/' << search << '/' << std::hex << std::setfill ('0') << std::setw (2) << hash % 256;
+      return oss. str ();
+    }
+  static Index readIndex (const string &shard)
+    { Index index;
+      ifstream f (shard + ".idx");
+      size_t hash = 0;
+      streamoff offset = 0;
+      while (f >> std::hex >> hash >> std::dec >> offset)
+        index. insert ({hash, offset});
+      return index;
+    }
+  static bool readRecord (istream &f,
+                          streamoff offset,
+                          const string &seq,
+                          StringVector &lines)
+    // Return: the record at offset is of seq
+    // Output: lines, if Return
+    { f. clear ();
+      f. seekg (offset);
+      string s;
+      if (! getline (f, s) || s != seq)  // hash collision
+        return false;
+      size_t n = 0;
+      if (! getline (f, s))
+        return false;
+      n = str2<size_t> (s);
+      lines. clear ();
+      lines. reserve (n);
+      while (lines. size () < n && getline (f, s))
+        lines << s;
+      return lines. size () == n;
+    }
+  static bool findRecord (const Index &index,
+                          const string &datFName,
+                          const string &seq,
+                          StringVector &lines)
+    // Return: seq is in index
+    // Output: lines, if Return
+    { const auto range = index. equal_range (str_hash (seq));
+      if (range. first == range. second)
+        return false;
+      ifstream f (datFName);
+      for (auto it = range. first; it != range. second; it++)
+        if (readRecord (f, it->second, seq, lines))
+          return true;
+      return false;
+    }
+public:
+  bool get (const string &search,
+            const string &seq,
+            StringVector &lines) const
+    // Return: seq is in the cache
+    // Output: lines, if Return
+    { const string shard (getShard (search, str_hash (seq)));
+      Index index;
+      {
+        const lock_guard<mutex> lg (mtx);
+        auto it = shard2index. find (shard);
+        if (it == shard2index. end ())
+          it = shard2index. insert ({shard, readIndex (shard)}). first;
+        const auto range = it->second. equal_range (str_hash (seq));
+        index. insert (range. first, range. second);
+      }
+      return findRecord (index, shard + ".dat", seq, lines);
+    }
+  void put (const string &search,
+            const unordered_map<string/*id*/,string/*seq*/> &id2seq,
+            const unordered_map<string/*id*/,StringVector/*search result lines*/> &id2lines) const
+    // Input: id2lines: no id <=> no hits
+    // Time: O(size of the shards of id2seq's indexes + size of the new records)
+    { map<string/*shard*/,VectorPtr<string>/*seq*/> shard2seqs;
+      map<const string*/*seq*/,const StringVector*/*lines*/> seq2lines;
+      for (const auto& it : id2seq)
+      {
+        shard2seqs [getShard (search, str_hash (it. second))] << & it. second;
+        seq2lines [& it. second] = findPtr (id2lines, it. first);
+      }
+      if (shard2seqs. empty ())
+        return;
+      std::filesystem::create_directories (dir + "/" + search);
+      const StringVector noLines;
+      for (const auto& it : shard2seqs)
+      {
+        const string& shard = it. first;
+        const string datFName (shard + ".dat");
+        const int fd = ::open (datFName. c_str (), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+        if (fd == -1)
+          throw runtime_error ("Cannot open " + shellQuote (datFName));
+        try
+        {
+          if (::flock (fd, LOCK_EX))
+            throw runtime_error ("Cannot lock " + shellQuote (datFName));
+          // Other processes may have added records
+          Index index (readIndex (shard));
+          const off_t end = ::lseek (fd, 0, SEEK_END);
+          if (end == -1)
+            throw runtime_error ("Cannot seek " + shellQuote (datFName));
+          string records;
+          StringVector lines_old;
+          for (const string* seq : it. second)
+          {
+            if (findRecord (index, datFName, *seq, lines_old))
+              continue;
+            index. insert ({str_hash (*seq), (streamoff) end + (streamoff) records. size ()});
+            const StringVector* lines = seq2lines [seq];
+            if (! lines)
+              lines = & noLines;
+            records += *seq + '\n' + to_string (lines->size ()) + '\n';
+            for (const string& line : *lines)
+              records += line + '\n';
+          }
+          for (size_t written = 0; written < records. size ();)
+          {
+            const ssize_t n = ::write (fd, records. c_str () + written, records. size () - written);
+            if (n <= 0)
+              throw runtime_error ("Cannot write " + shellQuote (datFName));
+            written += (size_t) n;
+          }
+          // The records are complete before the index refers to them
+          const string tmpFName (shard + ".idx." + to_string (getpid ()) + "." + to_string (std::hash<std::thread::id> () (std::this_thread::get_id ())));
+          {
+            OFStream f (tmpFName);
+            for (const auto& indexIt : index)
+              f << std::hex << indexIt. first << ' ' << std::dec << indexIt. second << '\n';
+          }
+          moveFile (tmpFName, shard + ".idx");
+          {
+            const lock_guard<mutex> lg (mtx);
+            shard2index [shard] = std::move (index);
+          }
+        }
+        catch (...)
+        {
+          ::close (fd);
+          throw;
+        }
+        ::close (fd);  // Unlocks
+      }
+    }
+};
+
+
+
 struct ThisApplication final : ShellApplication
 {
   ThisApplication ()
@@ -491,6 +1392,11 @@ struct ThisApplication final : ShellApplication
 
     	addKey ("parm", "amr_report parameters for testing: -nosame -noblast -skip_hmm_check -bed", "", '\0', "PARM");
 
+      addKey ("batch", "Tab-delimited file with the header: #name<tab>protein<tab>nucleotide<tab>gff<tab>organism. Each row is a sample processed as by the --name, --protein, --nucleotide, --gff and --organism options, an empty organism means --organism. The database is prepared once for all samples", "", '\0', "BATCH_FILE");
+      addKey ("batch_dir", "Directory for the reports of the --batch samples: <name>.tsv and <name>.mutation_all.tsv. OUTPUT_FILE and MUT_ALL_FILE are the combined reports", "", '\0', "BATCH_DIR");
+      addKey ("cache", "Directory for caching the blastp and hmmsearch results of proteins across runs. Can be shared by concurrent runs. The results of a different database version are not used", "", '\0', "CACHE_DIR");
+      addFlag ("blastx_windows", "Search the nucleotide sequences by blastx in parallel, also if some of them are longer than " + to_string (blastxDnaLen_max / 1000) + " kb and would be searched by tblastn. The sequences are split into overlapping windows of at most " + to_string (blastxDnaLen_max / 1000) + " kb. BLAST E-values are computed for the windows, so the hits close to the E-value threshold can differ from those of the whole sequences. Not used if a sequence identifier contains '|'");
+
 	    version = SVN_REV;  
 	    documentationUrl = "https://github.com/ncbi/amr/wiki";
 	    updatesUrl = "https://www.ncbi.nlm.nih.gov/mailman/listinfo/amrfinder-announce";
@@ -511,12 +1417,14 @@ struct ThisApplication final : ShellApplication
   void fastaCheck (const string &fName, 
                    bool prot, 
                    const string &qcS, 
+                   const string &dir,
                    const string &logFName, 
                    size_t &nSeq, 
                    size_t &len_max,
                    size_t &len_total,
                    const string &outFName) const
   // Input: fName, outFName: quoted
+  //        dir: temporary directory
   {
     ASSERT (fName != logFName);
     if (! outFName. empty ())
@@ -524,10 +1432,10 @@ struct ThisApplication final : ShellApplication
       ASSERT (outFName != fName);
       ASSERT (outFName != logFName);
     }
-    exec (fullProg ("fasta_check") + fName + "  " + (prot ? "-aa  -stop_codon  -ambig_max " + ambigS + prependS (outFName, "  -out ") : "-len " + tmp + "/len  -hyphen  -ambig") + qcS + "  -log " + logFName + " > " + tmp + "/nseq", logFName); 
+    exec (fullProg ("fasta_check") + fName + "  " + (prot ? "-aa  -stop_codon  -ambig_max " + ambigS + prependS (outFName, "  -out ") : "-len " + dir + "/len  -hyphen  -ambig") + qcS + "  -log " + logFName + " > " + dir + "/nseq", logFName); 
       // "-stop_codon" PD-4771 
 
-  	const StringVector vec (tmp + "/nseq", (size_t) 10, true); 
+  	const StringVector vec (dir + "/nseq", (size_t) 10, true); 
   	if (vec. size () != 3)
       throw runtime_error (string (prot ? "Protein" : "DNA") + " fasta_check failed: " + vec. toString ("\n"));
     nSeq      = str2<size_t> (vec [0]);
@@ -580,8 +1488,10 @@ struct ThisApplication final : ShellApplication
                            const string &db,
                            const string &dna_flat,
                            uint gencode,
-                           const string &qcS) const
+                           const string &qcS,
+                           const string &dir) const
   // PD-5301
+  // Input: dir: temporary directory
   {
     const TextTable::ColNum contig_col     = amrTab. col2num (contig_colName);
     const TextTable::ColNum prot_col       = amrTab. col2num (closestRefAccession_colName);
@@ -613,16 +1523,16 @@ struct ThisApplication final : ShellApplication
     if (disrRawTab. rows. empty ())
       return;
 
-    disrRawTab. saveFile (tmp + "/disr_raw");
+    disrRawTab. saveFile (dir + "/disr_raw");
     {
-      OFStream f (tmp + "/disr");
+      OFStream f (dir + "/disr");
       f << "#contig\tprot\tdisr\tdisr_raw\n";
       //     0       1     2   3
     }
     exec (fullProg ("disruption2genesymbol") + dna_flat + " " + shellQuote (db + "/AMRProt-susceptible.fa")  
-          + " " +  tmp + "/disr_raw  -prot_id_pos 1  -gencode " + to_string (gencode) + qcS + " -noprogress >> " + tmp + "/disr");
+          + " " +  dir + "/disr_raw  -prot_id_pos 1  -gencode " + to_string (gencode) + qcS + " -noprogress >> " + dir + "/disr");
           
-    const TextTable disrTab (tmp + "/disr");
+    const TextTable disrTab (dir + "/disr");
     disrTab. qc ();
     for (StringVector& row : amrTab. rows)
     {
@@ -707,6 +1617,10 @@ struct ThisApplication final : ShellApplication
     const uint    dnaFlank5_size   =             arg2uint ("nucleotide_flank5_size");
     const bool    gpipe_org        =             getFlag ("gpipe_org");
     const bool    database_version =             getFlag ("database_version");
+    const string  batch            =             getArg ("batch");
+    const string  batch_dir        =             getArg ("batch_dir");
+    const string  cache            =             getArg ("cache");
+    const bool    blastx_windows   =             getFlag ("blastx_windows");
     
     
 		const string logFName (tmp + "/log");  // Command-local log file
@@ -860,6 +1774,7 @@ struct ThisApplication final : ShellApplication
 
 
 		// PD-3051
+		string dbVersion;
 		{
   	  istringstream versionIss (version);
   		const SoftwareVersion softwareVersion (versionIss);
@@ -868,10 +1783,11 @@ struct ThisApplication final : ShellApplication
   		const DataVersion dataVersion (db + "/version.txt");
   		istringstream dataVersionIss (dataVer_min); 
   		const DataVersion dataVersion_min (dataVersionIss);  
+      dbVersion = dataVersion. str ();
       if (database_version)
-        cout   << "Database version: " << dataVersion. str () << endl;
+        cout   << "Database version: " << dbVersion << endl;
       else
-        stderr << "Database version: " << dataVersion. str () << '\n';
+        stderr << "Database version: " << dbVersion << '\n';
       if (softwareVersion < softwareVersion_min)
         throw runtime_error ("Database requires software version at least " + softwareVersion_min. str ());
       if (dataVersion < dataVersion_min)
@@ -895,7 +1811,22 @@ struct ThisApplication final : ShellApplication
     }    		
 
 		  
+    if (! batch. empty ())
+    {
+      if (! emptyArg (prot) || ! emptyArg (dna) || ! emptyArg (gff))
+        throw runtime_error ("Parameter --batch conflicts with parameters --protein, --nucleotide and --gff");
+      if (! emptyArg (input_name))
+        throw runtime_error ("Parameter --batch conflicts with parameter --name");
+      if (! emptyArg (prot_out) || ! emptyArg (dna_out) || ! emptyArg (dnaFlank5_out))
+        throw runtime_error ("Parameter --batch conflicts with FASTA output parameters");
+      if (batch_dir. empty ())
+        throw runtime_error ("Parameter --batch requires parameter --batch_dir");
+      stderr << "AMRFinder batch search\n";
+    }
+    else
     {
+      if (! batch_dir. empty ())
+        throw runtime_error ("Parameter --batch_dir requires parameter --batch");
       string searchMode;
       StringVector includes;
       if (emptyArg (prot))
@@ -950,82 +1881,10 @@ struct ThisApplication final : ShellApplication
     }
     
     
-    // Quoted names
-    const string prot_flat = uncompress (prot, "prot_flat");
-    const string dna_flat  = uncompress (dna,  "dna_flat");
-    const string gff_flat  = uncompress (gff,  "gff_flat");
-      
-
-    {
-      StringVector emptyFiles;
-      if (! emptyArg (prot) && ! getFileSize (unQuote (prot_flat)))  emptyFiles << prot;
-      if (! emptyArg (dna)  && ! getFileSize (unQuote (dna_flat)))   emptyFiles << dna;
-      if (! emptyArg (gff)  && ! getFileSize (unQuote (gff_flat)))   emptyFiles << gff;      
-      for (const string& emptyFile : emptyFiles)
-      {
-        const Warning warning (stderr);
-        stderr << "Empty file: " << emptyFile;
-      }
-    }
-
-
-	  // organism --> organism1
-	  string organism1;
-	  bool suppress_common = false;	  
-	  if (! emptyArg (organism))
-	  {
-	  	organism1 = unQuote (organism);
- 	  	replace (organism1, ' ', '_');
- 	  	ASSERT (! organism1. empty ());
-      if (gpipe_org)
-      {
-        const TextTable tab (db + "/taxgroup.tsv");
-        tab. qc ();
-        const TextTable::ColNum taxgroup_col      = tab. col2num ("taxgroup");
-        const TextTable::ColNum gpipeTaxgroup_col = tab. col2num ("gpipe_taxgroup");
-        bool found = false;
-        for (const StringVector& row : tab. rows)
-        {
-          QC_ASSERT (! row [taxgroup_col]. empty ());
-          const StringVector gpipeOrgVec (row [gpipeTaxgroup_col], ',', true);
-        //QC_ASSERT (gpipeOrgVec. size () >= 1);
-          if (gpipeOrgVec. contains (organism1))
-          {
-            organism1 = row [taxgroup_col];
-            found = true;
-            break;
-          }
-        }
-        if (! found)  // PD-4341
-        #if 0
-          throw runtime_error ("Non-existant GPipe taxgroup: " + organism);  
-        #else
-        {
-    	    const Warning warning (stderr);
-    		  stderr << "Non-existant GPipe taxgroup: " << organism;
-    		  organism1. clear ();
-        }
-        #endif
-      }
- 	  }
- 	  QC_ASSERT (! contains (organism1, ' '));
-
-	  if (! organism1. empty ())
-	  {
-      const StringVector organisms (db2organisms ());
-      if (! organisms. contains (organism1))
-        throw runtime_error ("Possible organisms: " + organisms. toString (", "));  
- 	  	if (! report_common)
- 	  	  suppress_common = true;
- 	  }
-
-
     const string qcS (qc_on ? " -qc" : "");
 		
 								  
     prog2dir ["fasta_check"]           = execDir;
-    prog2dir ["fasta2parts"]           = execDir;
-    prog2dir ["amr_report"]            = execDir;	
 		prog2dir ["dna_mutation"]          = execDir;
 		prog2dir ["disruption2genesymbol"] = execDir;
     prog2dir ["fasta_extract"]         = execDir;
@@ -1041,485 +1900,1130 @@ struct ThisApplication final : ShellApplication
         default: throw runtime_error ("--pgap conflicts with GFF type " + strQuote (Gff::names [(size_t) gffType]));
       }
     }
-    
-    bool lcl = false;
-    if (gffType == Gff::pgap && ! emptyArg (dna))  // PD-3347
+
+
+    Vector<Sample> samples;
+    if (batch. empty ())
     {
-      LineInput f (unQuote (dna_flat));
-      while (f. nextLine ())
-        if (isLeft (f. line, ">"))
-        {
-          lcl = isLeft (f. line, ">lcl|");
-          break;
-        }
+      Sample s;
+      s. name         = input_name;
+      s. prot         = prot;
+      s. dna          = dna;
+      s. gff          = gff;
+      s. organism     = organism;
+      s. output       = output;
+      s. mutation_all = mutation_all;
+      s. dir          = tmp;
+      samples << std::move (s);
+    }
+    else
+    {
+      const TextTable manifest (batch);
+      manifest. qc ();
+      const TextTable::ColNum name_col     = manifest. col2num ("name");
+      const TextTable::ColNum prot_col     = manifest. col2num ("protein");
+      const TextTable::ColNum dna_col      = manifest. col2num ("nucleotide");
+      const TextTable::ColNum gff_col      = manifest. col2num ("gff");
+      const TextTable::ColNum organism_col = manifest. col2num ("organism");
+      StringVector names;  names. reserve (manifest. rows. size ());
+      for (const StringVector& row : manifest. rows)
+      {
+        const string& name = row [name_col];
+        if (name. empty ())
+          throw runtime_error ("Empty sample name in " + strQuote (batch));
+        if (contains (name, '/'))
+          throw runtime_error ("Sample name cannot contain '/': " + strQuote (name));
+        Sample s;
+        s. name     = shellQuote (name);
+        s. prot     = shellQuote (prependS (row [prot_col], dir));
+        s. dna      = shellQuote (prependS (row [dna_col],  dir));
+        s. gff      = shellQuote (prependS (row [gff_col],  dir));
+        s. organism = row [organism_col]. empty () ? organism : shellQuote (row [organism_col]);
+        if (emptyArg (s. prot) && emptyArg (s. dna))
+          throw runtime_error ("Sample " + strQuote (name) + ": protein or nucleotide file must be present");
+        if (emptyArg (s. prot) && ! emptyArg (s. gff))
+          throw runtime_error ("Sample " + strQuote (name) + ": GFF file is redundant");
+        if (! emptyArg (s. prot) && ! emptyArg (s. dna) && emptyArg (s. gff))
+          throw runtime_error ("Sample " + strQuote (name) + ": if protein and nucleotide files are present then GFF file must be present");
+        s. output = batch_dir + "/" + name + ".tsv";
+        if (! mutation_all. empty ())
+          s. mutation_all = batch_dir + "/" + name + ".mutation_all.tsv";
+        s. sub = to_string (samples. size () + 1) + "/";
+        s. dir = tmp + "/" + to_string (samples. size () + 1);
+        names << name;
+        samples << std::move (s);
+      }
+      if (samples. empty ())
+        throw runtime_error ("No samples in " + strQuote (batch));
+      names. sort ();
+      const size_t i = names. findDuplicate ();
+      if (i != no_index)
+        throw runtime_error ("Duplicate sample name: " + strQuote (names [i]));
+      createDirectory (batch_dir);
+      stderr << "Samples: " << samples. size () << '\n';
     }
-    
 
-	  const bool blastn = ! emptyArg (dna) && ! organism1. empty () && fileExists (db + "/AMR_DNA-" + organism1 + ".fa");
-		const bool stxTyper = blastn && organism1 == "Escherichia" && add_plus;
-		
-		
-		if (blastn)
+
+    // Database-derived data shared by the samples
+    StringVector organisms;
+    StringVector susceptibleOrganisms;
+    for (const Sample& s : samples)
+      if (! emptyArg (s. organism))
+      {
+        organisms = db2organisms ();
+        const TextTable tab (db + "/AMRProt-susceptible.tsv");
+        tab. qc ();
+        const TextTable::ColNum taxgroup_col = tab. col2num ("taxgroup");
+        for (const StringVector& row : tab. rows)
+        {
+          QC_ASSERT (! row [taxgroup_col]. empty ());
+          susceptibleOrganisms << row [taxgroup_col];
+        }
+        susceptibleOrganisms. sort ();
+        susceptibleOrganisms. uniq ();
+        break;
+      }
+    unique_ptr<const TextTable> taxgroupTab;
+    if (gpipe_org)
     {
-      // PD-5054
-      const string dbTest1 (db + "/AMR_DNA-" + organism1 + ".fa.ndb");
-      const string dbTest2 (db + "/AMR_DNA-" + organism1 + ".fa.nin");  // For older versions of blast; PD-5167
-  		if (   ! fileExists (dbTest1) 
-  		    && ! fileExists (dbTest2)
-  		   )
-  			throw runtime_error ("The BLAST database for AMR_DNA-" + organism1 + ".fa was not found.\nUse amrfinder -u or amrfinder --force_update to download and prepare database for AMRFinderPlus");
+      taxgroupTab. reset (new TextTable (db + "/taxgroup.tsv"));
+      taxgroupTab->qc ();
     }
+    map<pair<string,size_t>,string> blastThreadsParams;
+    const auto blastThreadsParam = [&blastThreadsParams, this] (const string &blast,
+                                                                 size_t threads)
+      { string& s = blastThreadsParams [pair<string,size_t> (blast, threads)];
+        if (s. empty ())
+          s = ' ' + getBlastThreadsParam (blast, threads);
+        return s. substr (1);
+      };
+    bool stxTyperChecked = false;
+
+
+    const auto prepareSample = [&] (Sample &s)
+      // Output: s, files in s.dir
+      {
+        const string logFName (s. dir + "/log");
+        
+        // Quoted names
+        s. prot_flat = uncompress (s. prot, s. sub + "prot_flat");
+        s. dna_flat  = uncompress (s. dna,  s. sub + "dna_flat");
+        s. gff_flat  = uncompress (s. gff,  s. sub + "gff_flat");
+        s. prot1 = s. prot_flat;
 
-		if (stxTyper)
-		{
-		  const string verFName (tmp + "/stxtyper-ver");
-			exec (fullProg ("stxtyper") + " -v > " + verFName, logFName);
-	    LineInput f (verFName);
-	    if (! f. nextLine ())
-	      throw runtime_error ("Cannot get the version of StxTyper");
-	    if (f. line != stxTyperVersion)
-	      throw runtime_error ("AMRFinder invokes StxTyper version " + f. line + ". Expected StxTyper version is " + stxTyperVersion);		  
-		}
+        {
+          StringVector emptyFiles;
+          if (! emptyArg (s. prot) && ! getFileSize (unQuote (s. prot_flat)))  emptyFiles << s. prot;
+          if (! emptyArg (s. dna)  && ! getFileSize (unQuote (s. dna_flat)))   emptyFiles << s. dna;
+          if (! emptyArg (s. gff)  && ! getFileSize (unQuote (s. gff_flat)))   emptyFiles << s. gff;      
+          for (const string& emptyFile : emptyFiles)
+          {
+            const Warning warning (stderr);
+            stderr << "Empty file: " << emptyFile;
+          }
+        }
 
 
-    // Create files for amr_report    
-    string amr_report_blastp;	
- 		string amr_report_blastx;
- 		bool hmmChunks = false;
- 		bool tblastnChunks = false;
- 		bool slowBlastx = false;
-	  string annotS (" -gfftype " + Gff::names [(size_t) gffType] + ifS (lcl, " -lcl"));
-    {
-  		// PD-2967
-  		if (! emptyArg (prot))
-  		{
-  			string gff_prot_match;
- 			  string gff_dna_match;
-  			if (getFileSize (unQuote (prot_flat)))
-  			{
-    			findProg ("blastp");  			
-    			findProg ("hmmsearch");
-    			
-    			string prot1 (prot_flat);  // Protein FASTA with no dashes in the sequences
-          size_t nProt = 0;
-          size_t protLen_max = 0;
-          size_t protLen_total = 0;
-
-          try
+    	  // organism --> organism1
+    	  if (! emptyArg (s. organism))
+    	  {
+    	  	s. organism1 = unQuote (s. organism);
+     	  	replace (s. organism1, ' ', '_');
+     	  	ASSERT (! s. organism1. empty ());
+          if (gpipe_org)
           {
-      	    fastaCheck (prot_flat, true, qcS, logFName, nProt, protLen_max, protLen_total, noString);
-      	  }
-      	  catch (...)
-      	  {
-       	    bool fixable = false;
-        	  {
-        	    LineInput f (logFName);
-        	    while (f. nextLine ())
-        	      // Cf. fasta_check.cpp
-          	    if (contains (f. line, "Hyphen in the sequence"))  
-                {
-            	    const Warning warning (stderr);
-            		  stderr << "Ignoring dash '-' characters in the sequences of the protein file " << prot;
-            		  fixable = true;
-            		  break;
-            		}
-          	    else if (contains (f. line, "Too many ambiguities"))  
-                {
-            	    const Warning warning (stderr);
-            		  stderr << "Removing sequences with >= " << ambigS << " Xs from the protein file " << prot;
-            		  fixable = true;
-            		  break;
-            		}
-              #if 0
-          	    else if (contains (f. line, "'*' at the sequence end"))  
-                {
-            	    const Warning warning (stderr);
-            		  stderr << "Removing '*' from the ends of protein sequences in " << prot;
-            		  fixable = true;
-            		  break;
-            		}
-            	#endif
-          	}
-          	if (fixable)
-          	  removeFile (logFName);
-          	else
-          	  throw;
-            prot1 = shellQuote (tmp + "/prot");
-          	fastaCheck (prot_flat, true, qcS, logFName, nProt, protLen_max, protLen_total, prot1);
-      	  }
-    			
-   			  // gff_check
-    			if (! emptyArg (gff) && ! contains (parm, "-bed"))
+            ASSERT (taxgroupTab. get ());
+            const TextTable& tab = *taxgroupTab;
+            const TextTable::ColNum taxgroup_col      = tab. col2num ("taxgroup");
+            const TextTable::ColNum gpipeTaxgroup_col = tab. col2num ("gpipe_taxgroup");
+            bool found = false;
+            for (const StringVector& row : tab. rows)
+            {
+              QC_ASSERT (! row [taxgroup_col]. empty ());
+              const StringVector gpipeOrgVec (row [gpipeTaxgroup_col], ',', true);
+            //QC_ASSERT (gpipeOrgVec. size () >= 1);
+              if (gpipeOrgVec. contains (s. organism1))
+              {
+                s. organism1 = row [taxgroup_col];
+                found = true;
+                break;
+              }
+            }
+            if (! found)  // PD-4341
+            #if 0
+              throw runtime_error ("Non-existant GPipe taxgroup: " + s. organism);  
+            #else
+            {
+        	    const Warning warning (stderr);
+        		  stderr << "Non-existant GPipe taxgroup: " << s. organism;
+        		  s. organism1. clear ();
+            }
+            #endif
+          }
+     	  }
+     	  QC_ASSERT (! contains (s. organism1, ' '));
+
+    	  if (! s. organism1. empty ())
+    	  {
+          if (! organisms. contains (s. organism1))
+            throw runtime_error ("Possible organisms: " + organisms. toString (", "));  
+     	  	if (! report_common)
+     	  	  s. suppress_common = true;
+     	  }
+
+        bool lcl = false;
+        if (gffType == Gff::pgap && ! emptyArg (s. dna))  // PD-3347
+        {
+          LineInput f (unQuote (s. dna_flat));
+          while (f. nextLine ())
+            if (isLeft (f. line, ">"))
+            {
+              lcl = isLeft (f. line, ">lcl|");
+              break;
+            }
+        }
+        
+
+    	  s. blastn = ! emptyArg (s. dna) && ! s. organism1. empty () && fileExists (db + "/AMR_DNA-" + s. organism1 + ".fa");
+    		s. stxTyper = s. blastn && s. organism1 == "Escherichia" && add_plus;
+    		
+    		
+    		if (s. blastn)
+        {
+          // PD-5054
+          const string dbTest1 (db + "/AMR_DNA-" + s. organism1 + ".fa.ndb");
+          const string dbTest2 (db + "/AMR_DNA-" + s. organism1 + ".fa.nin");  // For older versions of blast; PD-5167
+      		if (   ! fileExists (dbTest1) 
+      		    && ! fileExists (dbTest2)
+      		   )
+      			throw runtime_error ("The BLAST database for AMR_DNA-" + s. organism1 + ".fa was not found.\nUse amrfinder -u or amrfinder --force_update to download and prepare database for AMRFinderPlus");
+        }
+
+    		if (s. stxTyper && ! stxTyperChecked)
+    		{
+    		  const string verFName (tmp + "/stxtyper-ver");
+    			exec (fullProg ("stxtyper") + " -v > " + verFName, logFName);
+    	    LineInput f (verFName);
+    	    if (! f. nextLine ())
+    	      throw runtime_error ("Cannot get the version of StxTyper");
+    	    if (f. line != stxTyperVersion)
+    	      throw runtime_error ("AMRFinder invokes StxTyper version " + f. line + ". Expected StxTyper version is " + stxTyperVersion);		  
+    	    stxTyperChecked = true;
+    		}
+
+
+        // Create files for amr_report    
+    	  string annotS (" -gfftype " + Gff::names [(size_t) gffType] + ifS (lcl, " -lcl"));
+    	  Gff::Type annotType = gffType;
+    	  bool annotLcl = lcl;
+    		// PD-2967
+    		if (! emptyArg (s. prot))
+    		{
+    			string gff_prot_match;
+   			  string gff_dna_match;
+    			if (getFileSize (unQuote (s. prot_flat)))
     			{
-    			  prog2dir ["gff_check"] = execDir;		
-    			  string dnaPar;
-    			  if (! emptyArg (dna))
-    			    dnaPar = " -dna " + dna_flat;
-    			  if (gffType == Gff::pgap)
+      			findProg ("blastp");  			
+      			findProg ("hmmsearch");
+      			
+            size_t protLen_max = 0;
+
+            try
+            {
+        	    fastaCheck (s. prot_flat, true, qcS, s. dir, logFName, s. nProt, protLen_max, s. protLen_total, noString);
+        	  }
+        	  catch (...)
+        	  {
+         	    bool fixable = false;
+          	  {
+          	    LineInput f (logFName);
+          	    while (f. nextLine ())
+          	      // Cf. fasta_check.cpp
+            	    if (contains (f. line, "Hyphen in the sequence"))  
+                  {
+              	    const Warning warning (stderr);
+              		  stderr << "Ignoring dash '-' characters in the sequences of the protein file " << s. prot;
+              		  fixable = true;
+              		  break;
+              		}
+            	    else if (contains (f. line, "Too many ambiguities"))  
+                  {
+              	    const Warning warning (stderr);
+              		  stderr << "Removing sequences with >= " << ambigS << " Xs from the protein file " << s. prot;
+              		  fixable = true;
+              		  break;
+              		}
+                #if 0
+            	    else if (contains (f. line, "'*' at the sequence end"))  
+                  {
+              	    const Warning warning (stderr);
+              		  stderr << "Removing '*' from the ends of protein sequences in " << s. prot;
+              		  fixable = true;
+              		  break;
+              		}
+              	#endif
+            	}
+            	if (fixable)
+            	  removeFile (logFName);
+            	else
+            	  throw;
+              s. prot1 = shellQuote (s. dir + "/prot");
+            	fastaCheck (s. prot_flat, true, qcS, s. dir, logFName, s. nProt, protLen_max, s. protLen_total, s. prot1);
+        	  }
+      			
+     			  // gff_check
+      			if (! emptyArg (s. gff) && ! contains (parm, "-bed"))
+      			{
+      			  prog2dir ["gff_check"] = execDir;		
+      			  string dnaPar;
+      			  if (! emptyArg (s. dna))
+      			    dnaPar = " -dna " + s. dna_flat;
+      			  s. gffType = gffType;
+      			  if (s. gffType == Gff::pgap)
+        			  try 
+        			  {
+        			    exec (fullProg ("gff_check") + s. gff_flat + "  -gfftype " + Gff::names [(size_t) Gff::standard] + "  -prot " + s. prot1 + dnaPar + qcS + " -log " + logFName, logFName);
+        			    s. gffType = Gff::standard;
+        			    annotS = " -gfftype " + Gff::names [(size_t) Gff::standard];
+        			    annotType = Gff::standard;
+        			    annotLcl = false;
+        			  }
+        			  catch (...) {}
+
+
+      			  {
+        			  bool gffProtMatchP = false;
+        			  switch (s. gffType)
+        			  {
+        			    case Gff::genbank:
+            			  {
+              			  LineInput f (unQuote (s. prot1));
+              			  while (f. nextLine ())
+              			    if (   ! f. line. empty () 
+              			        && f. line [0] == '>'
+              			       )
+              			    {
+              			      gffProtMatchP = contains (f. line, "[locus_tag=");  
+              			      break;
+              			    }
+              			}
+              			break;
+              	  case Gff::microscope: gffProtMatchP = true; break;
+              	  case Gff::prodigal:   gffProtMatchP = true; break;
+              	  default: break;
+              	}
+        			  if (gffProtMatchP)
+        			  {
+        			    gff_prot_match = " -gff_prot_match " + s. dir + "/prot_match";
+        			    s. amrReportPar. gffProtMatchFName = s. dir + "/prot_match";
+        			  }
+        			}
+      			  if (! emptyArg (s. dna) && s. gffType == Gff::pseudomonasdb)
+      			  {
+      			    gff_dna_match = " -gff_dna_match " + s. dir + "/dna_match";
+      			    s. amrReportPar. gffDnaMatchFName = s. dir + "/dna_match";
+      			  }
       			  try 
       			  {
-      			    exec (fullProg ("gff_check") + gff_flat + "  -gfftype " + Gff::names [(size_t) Gff::standard] + "  -prot " + prot1 + dnaPar + qcS + " -log " + logFName, logFName);
-      			    gffType = Gff::standard;
-      			    annotS = " -gfftype " + Gff::names [(size_t) Gff::standard];
+      			    exec (fullProg ("gff_check") + s. gff_flat + annotS + " -prot " + s. prot1 + dnaPar + gff_prot_match + gff_dna_match + qcS + " -log " + logFName, logFName);
       			  }
-      			  catch (...) {}
-
-
-    			  {
-      			  bool gffProtMatchP = false;
-      			  switch (gffType)
+      			  catch (...)
       			  {
-      			    case Gff::genbank:
-          			  {
-            			  LineInput f (unQuote (prot1));
-            			  while (f. nextLine ())
-            			    if (   ! f. line. empty () 
-            			        && f. line [0] == '>'
-            			       )
-            			    {
-            			      gffProtMatchP = contains (f. line, "[locus_tag=");  
-            			      break;
-            			    }
-            			}
-            			break;
-            	  case Gff::microscope: gffProtMatchP = true; break;
-            	  case Gff::prodigal:   gffProtMatchP = true; break;
-            	  default: break;
-            	}
-      			  if (gffProtMatchP)
-      			    gff_prot_match = " -gff_prot_match " + tmp + "/prot_match";
+      			    StringVector vec (logFName, (size_t) 10, false);  // PAR
+      			    if (! vec. empty ())
+      			      if (vec [0]. empty ())
+      			        vec. eraseAt (0);
+      			    if (! vec. empty ())
+      			      if (vec [0] == error_caption)
+      			        vec. eraseAt (0);
+      			    throw runtime_error ("GFF file mismatch.\n" + vec. toString ("\n"));  // PD-3289, PD-3345
+      			  } 
       			}
-    			  if (! emptyArg (dna) && gffType == Gff::pseudomonasdb)
-    			    gff_dna_match = " -gff_dna_match " + tmp + "/dna_match";
-    			  try 
-    			  {
-    			    exec (fullProg ("gff_check") + gff_flat + annotS + " -prot " + prot1 + dnaPar + gff_prot_match + gff_dna_match + qcS + " -log " + logFName, logFName);
-    			  }
-    			  catch (...)
-    			  {
-    			    StringVector vec (logFName, (size_t) 10, false);  // PAR
-    			    if (! vec. empty ())
-    			      if (vec [0]. empty ())
-    			        vec. eraseAt (0);
-    			    if (! vec. empty ())
-    			      if (vec [0] == error_caption)
-    			        vec. eraseAt (0);
-    			    throw runtime_error ("GFF file mismatch.\n" + vec. toString ("\n"));  // PD-3289, PD-3345
-    			  } 
-    			}
-    			    			
-    			stderr. section ("Running blastp");
+      			    			
+      			s. protSearch = true;
+    		  }
+    		  else
+    		  {
+    		    OFStream::create (s. dir + "/blastp");
+    		    OFStream::create (s. dir + "/hmmsearch");
+    		    OFStream::create (s. dir + "/dom");
+    		  }  
+
+    		  s. amrReportPar. blastpFName = s. dir + "/blastp";
+    		  s. amrReportPar. hmmsearch   = s. dir + "/hmmsearch";
+    		  s. amrReportPar. hmmDom      = s. dir + "/dom";
+    			if (! emptyArg (s. gff))
     			{
-      			const Chronometer_OnePass_cerr cop ("blastp");
-      			// " -task blastp-fast -word_size 6  -threshold 21 "  // PD-2303
-      			exec (fullProg ("blastp") + " -query " + prot1 + " -db " + tmp + "/db/AMRProt.fa" 
-      			      + Seq_sp::Hsp::blastp_fast + " -task blastp-fast"  
-      			      + getBlastThreadsParam ("blastp", min (nProt, protLen_total / 10000)) + Seq_sp::Hsp::format_par (false) + " -out " + tmp + "/blastp > /dev/null 2> " + tmp + "/blastp-err", tmp + "/blastp-err");
+    			  s. amrReportPar. gffFName = unQuote (s. gff_flat);
+    			  s. amrReportPar. gffType  = annotType;
+    			  s. amrReportPar. lcl      = annotLcl;
+    			}
+    		}  		
+
+    		
+    		if (! emptyArg (s. dna))
+    		{
+    		  if (getFileSize (unQuote (s. dna_flat)))
+      		{
+            size_t dnaLen_max = 0;
+            fastaCheck (s. dna_flat, false, qcS, s. dir, logFName, s. nDna, dnaLen_max, s. dnaLen_total, noString); 
+            s. blastx = dnaLen_max > blastxDnaLen_max && ! (blastx_windows && packable (s. dna_flat)) ? "tblastn" : "blastx";
+      			findProg (s. blastx);
+
+            // Susceptible
+            if (   ! s. organism1. empty ()
+                && susceptibleOrganisms. containsFast (s. organism1)
+               )
+            {
+        			findProg ("tblastn");
+              s. slowBlastx = true;
+            }
+
+            if (s. blastn)
+        			findProg ("blastn");
       		}
-    			  
-    			stderr. section ("Running hmmsearch");
-    			{
-       			const Chronometer_OnePass_cerr cop ("hmmsearch");
-      			ASSERT (threads_max >= 1);
-      			if (threads_max > 1 && nProt > threads_max / 2)  // PAR
+      		else
+      		{
+    		    OFStream::create (s. dir + "/blastx");
+    		    OFStream::create (s. dir + "/len");
+        		if (s. blastn)
+      		    OFStream::create (s. dir + "/blastn");
+    		  }
+     		  s. amrReportPar. blastxFName = s. dir + "/blastx";
+     		  s. amrReportPar. dnaLenFName = s. dir + "/len";
+    		}
+
+
+      	if (s. suppress_common)
+      	{
+    			OFStream outF (s. dir + "/suppress_prot");
+    			LineInput f (db + "/AMRProt-suppress.tsv");
+    			while (f. nextLine ())
+    			  if (! isLeft (f. line, "#"))
       			{
-        		  createDirectory (tmp + "/hmm_chunk");
-        		  exec (fullProg ("fasta2parts") + prot1 + " " + to_string (threads_max) + " " + tmp + "/hmm_chunk" + qcS + " -log " + logFName, logFName);
-        		  createDirectory (tmp + "/hmmsearch_dir");
-        		  createDirectory (tmp + "/dom_dir");
-              Threads th (threads_max - 1, true);  
-        		  DirItemGenerator dig (0, tmp + "/hmm_chunk", false);
-        		  string item;
-        		  while (dig. next (item))
-          			th. exec (fullProg ("hmmsearch") 
-      			              + "  --tblout "    + tmp + "/hmmsearch_dir/" + item + "  --noali"
-      			              + "  --domtblout " + tmp + "/dom_dir/"       + item + "  --cut_tc  -Z 10000  --cpu 0  " + tmp + "/db/AMR.LIB" + " " + tmp + "/hmm_chunk/" + item + " > /dev/null 2> /dev/null"
-      			             );
-        		  hmmChunks = true;
-        	  }
-        	  else
-        			exec (fullProg ("hmmsearch") + " --tblout " + tmp + "/hmmsearch  --noali  --domtblout " + tmp + "/dom  --cut_tc  -Z 10000  --cpu " + to_string (threads_max - 1) + "  " + tmp + "/db/AMR.LIB" + " " + prot1 + " > /dev/null 2> /dev/null", logFName);
-        	}
-  		  }
-  		  else
-  		  {
-  		    OFStream::create (tmp + "/blastp");
-  		    OFStream::create (tmp + "/hmmsearch");
-  		    OFStream::create (tmp + "/dom");
-  		  }  
-
-  		  amr_report_blastp = "-blastp " + tmp + "/blastp  -hmmsearch " + tmp + "/hmmsearch  -hmmdom " + tmp + "/dom";
-  			if (! emptyArg (gff))
-  			  amr_report_blastp += "  -gff " + gff_flat + gff_prot_match + gff_dna_match + annotS;
-  		}  		
-
-  		
-  		if (! emptyArg (dna))
-  		{
-  		  if (getFileSize (unQuote (dna_flat)))
-    		{
-          size_t nDna = 0;
-          size_t dnaLen_max = 0;
-          size_t dnaLen_total = 0;
-          fastaCheck (dna_flat, false, qcS, logFName, nDna, dnaLen_max, dnaLen_total, noString); 
-          const string blastx (dnaLen_max > 100000 ? "tblastn" : "blastx");  // PAR  // SB-3643
-
-    			stderr. section ("Running " + blastx);
-    			findProg (blastx);
-          {
-       			const Chronometer_OnePass_cerr cop (blastx);
-            const string tblastn_par (string (Seq_sp::Hsp::blastp_fast) + "  -task tblastn-fast  -window_size 15  -threshold 100  -db_gencode " + to_string (gencode));  // SB-3643, PD-4522
-        		const string blastx_par  (string (Seq_sp::Hsp::blastp_fast) + "  -query_gencode " + to_string (gencode));
-        		  // Was: -word_size 3
-      			ASSERT (threads_max >= 1);
-      			if (blastx == "blastx")
-        			exec (fullProg ("blastx") + "  -query " + dna_flat + " -db " + tmp + "/db/AMRProt.fa" + "  "
-            			  + blastx_par + Seq_sp::Hsp::format_par (false) + " " + getBlastThreadsParam ("blastx", min (nDna, dnaLen_total / 10002))
-            			  + " -out " + tmp + "/blastx > /dev/null 2> " + tmp + "/blastx-err", tmp + "/blastx-err");
+      			  string org, accver;
+      			  istringstream iss (f. line);
+      			  iss >> org >> accver;
+      			  QC_ASSERT (! accver. empty ());
+      			  if (org == s. organism1)
+      			    outF << accver << endl;
+      			}
+    	  }
+      };
+      
+      
+    const auto requestSearches = [&] (const Sample &s,
+                                      StringVector &names,
+                                      Vector<size_t> &requested)
+      // Output: names, requested: CPU requests of the searches of s
+      {
+        // PAR
+        if (s. protSearch && ! s. protPacked)
+        {
+          names << "blastp" << "hmmsearch";
+          requested << max<size_t> (min (s. nProt, s. protLen_total / 10000), 1)
+                    << threads_max;
+        }
+        if (! s. blastx. empty () && ! s. blastxPacked)
+        {
+          names << s. blastx;
+          requested << (s. blastx == "blastx" ? max<size_t> (min (s. nDna + (blastx_windows ? s. dnaLen_total / blastxDnaLen_max : 0), s. dnaLen_total / 10002), 1) : threads_max);
+        }
+        if (s. slowBlastx)
+        {
+          names << "tblastn (for susceptible)";
+          requested << 1;
+        }
+        if (s. blastn)
+        {
+          names << "blastn";
+          requested << 1;
+        }
+        if (s. stxTyper)
+        {
+          names << "stxtyper";
+          requested << 1;
+        }
+      };
+      
+      
+    const string printNode (print_node ? " -print_node" : "");
+    const ExactIndex exactIndex (tmp + "/db/AMRProt-exact.tsv");
+    unique_ptr<const HitCache> hitCache;
+    if (! cache. empty ())
+    {
+      // Search parameters which change the results
+      const string searchPar (string (Seq_sp::Hsp::blastp_fast) + " -task blastp-fast" + Seq_sp::Hsp::format_par (false) + " --cut_tc -Z 10000");
+      hitCache. reset (new HitCache (cache, dbVersion + "." + to_string (str_hash (searchPar) % 1000000)));  // PAR
+    }
+    const auto addBlastp = [&] (StageGraph &graph,
+                                size_t t,
+                                const string &query,
+                                const string &dir)
+      // Return: Stage index
+      // Input: query: quoted
+      // Output: dir + "/blastp"
+      {
+        // " -task blastp-fast -word_size 6  -threshold 21 "  // PD-2303
+        const string par (string (" -db ") + tmp + "/db/AMRProt.fa" 
+                          + Seq_sp::Hsp::blastp_fast + " -task blastp-fast"  
+                          + blastThreadsParam ("blastp", t) + Seq_sp::Hsp::format_par (false) + " 2> " + dir + "/blastp-err");
+        return graph. add ("blastp", t, [this, par, query, dir, &exactIndex, &hitCache] () 
+          { const Chronometer_OnePass_cerr cop ("blastp");
+            if (! packable (query))
+            {
+              exec (fullProg ("blastp") + " -query " + query + " -out " + dir + "/blastp" + par + " > /dev/null", dir + "/blastp-err"); 
+              return;
+            }
+            // Identical proteins are BLAST'ed once
+            const ProtDedup dedup (unQuote (query));
+            string uniq (unQuote (query));
+            string out (dir + "/blastp");
+            if (dedup. redundant ())
+            {
+              uniq = dir + "/blastp_uniq";
+              out  = dir + "/blastp_dedup";
+              dedup. saveUniq (unQuote (query), uniq);
+            }
+            if (exactIndex. empty () && ! hitCache)
+              exec (fullProg ("blastp") + " -query " + shellQuote (uniq) + " -out " + out + par + " > /dev/null", dir + "/blastp-err"); 
             else
             {
-              ASSERT (blastx == "tblastn");
-        			if (threads_max > 1)
-        			{
-          		  createDirectory (tmp + "/AMRProt_chunk");
-          		  exec (fullProg ("fasta2parts") + " " + shellQuote (db + "/AMRProt.fa") + " " + to_string (threads_max) + " " + tmp + "/AMRProt_chunk" + qcS + " -log " + logFName, logFName);
-          		  createDirectory (tmp + "/tblastn_dir");
-          		  createDirectory (tmp + "/tblastn_dir.err");
-                Threads th (threads_max - 1, true);  
-          		  DirItemGenerator dig (0, tmp + "/AMRProt_chunk", false);
-          		  string item;
-          		  while (dig. next (item))
-            			th. exec (fullProg ("tblastn") + "  -subject " + dna_flat + "  -query " + tmp + "/AMRProt_chunk/" + item + "  "
-              			        + tblastn_par + Seq_sp::Hsp::format_par (true) + "  -out " + tmp + "/tblastn_dir/" + item + " > /dev/null 2> " + tmp + "/tblastn_dir.err/" + item);
-          		  tblastnChunks = true;
-          	  }
-          	  else
-          			exec (fullProg ("tblastn") + "  -subject " + dna_flat + "  -query " + tmp + "/db/AMRProt.fa  "
-              			  + tblastn_par + Seq_sp::Hsp::format_par (true) + "  -out " + tmp + "/blastx > /dev/null 2> " + tmp + "/tblastn-err", tmp + "/tblastn-err");
+              // Proteins with known hits are not BLAST'ed
+              unordered_map<string/*id*/,StringVector/*BLAST lines without id*/> id2lines;
+              unordered_map<string/*id*/,string/*seq*/> newSeqs;
+              {
+                OFStream f (dir + "/blastp_query");
+                forEachSeq (uniq, [&] (const string &id, const string &seq, const string &record)
+                                    { StringVector lines;
+                                      if (   exactIndex. get (seq, lines)
+                                          || (hitCache && hitCache->get ("blastp", seq, lines))
+                                         )
+                                        id2lines [id] = std::move (lines);
+                                      else
+                                      {
+                                        f << record;
+                                        newSeqs [id] = seq;
+                                      }
+                                    }
+                           );
+              }
+              if (! newSeqs. empty ())
+              {
+                // BLAST output is parsed while BLAST is running
+                string id;
+                execLines (fullProg ("blastp") + " -query " + dir + "/blastp_query" + par, 
+                           [&] (const string &blastLine)
+                             { string line (blastLine_removeId (blastLine, id));
+                               if (! contains (newSeqs, id))
+                                 throw runtime_error ("Unknown protein id in BLAST output:\n" + blastLine);
+                               id2lines [id] << std::move (line);
+                             },
+                           dir + "/blastp-err");
+                if (hitCache)
+                  hitCache->put ("blastp", newSeqs, id2lines);
+              }
+              {
+                OFStream f (out);
+                forEachSeq (uniq, [&] (const string &id, const string &/*seq*/, const string &/*record*/)
+                                    { if (const StringVector* lines = findPtr (id2lines, id))
+                                        for (const string& line : *lines)
+                                          f << blastLine_insertId (line, id) << '\n';
+                                    }
+                           );
+              }
             }
-          }
-          
-          // Susceptible
-          if (! organism1. empty ())
-          {
-            const TextTable tab (db + "/AMRProt-susceptible.tsv");
-            tab. qc ();
-            const TextTable::ColNum taxgroup_col = tab. col2num ("taxgroup");
-            bool found = false;
-            for (const StringVector& row : tab. rows)
+            if (dedup. redundant ())
+              dedup. fanOut (out, true, dir + "/blastp");
+          });
+      };
+    const auto addHmmsearch = [&] (StageGraph &graph,
+                                   size_t t,
+                                   const string &query,
+                                   size_t nProt,
+                                   const string &dir)
+      // Return: Stage index
+      // Input: query: quoted
+      // Output: dir + "/hmmsearch", dir + "/dom"
+      {
+        return graph. add ("hmmsearch", t, [this, t, query, nProt, dir, &hitCache] () 
+          { const Chronometer_OnePass_cerr cop ("hmmsearch");
+            // Identical proteins are searched once
+            const ProtDedup dedup (unQuote (query));
+            string uniq (query);
+            size_t nUniq = nProt;
+            string hmmsearch (dir + "/hmmsearch");
+            string dom       (dir + "/dom");
+            if (dedup. redundant ())
             {
-              QC_ASSERT (! row [taxgroup_col]. empty ());
-              if (row [taxgroup_col] == organism1)
+              nUniq = dedup. saveUniq (unQuote (query), dir + "/hmm_uniq");
+              uniq = shellQuote (dir + "/hmm_uniq");
+              hmmsearch += "_dedup";
+              dom       += "_dedup";
+            }
+            // Proteins with cached hits are not searched
+            unordered_map<string/*id*/,StringVector/*hmmsearch table lines without id*/> id2lines;
+            unordered_map<string/*id*/,string/*seq*/> newSeqs;
+            StringVector cachedIds;
+            const string hmmsearch_out (hitCache ? dir + "/hmmsearch_new" : hmmsearch);
+            const string dom_out       (hitCache ? dir + "/dom_new"       : dom);
+            if (hitCache)
+            {
+              OFStream f (dir + "/hmm_query");
+              forEachSeq (unQuote (uniq), [&] (const string &id, const string &seq, const string &record)
+                                            { StringVector lines;
+                                              if (hitCache->get ("hmmsearch", seq, lines))
+                                              {
+                                                id2lines [id] = std::move (lines);
+                                                cachedIds << id;
+                                              }
+                                              else
+                                              {
+                                                f << record;
+                                                newSeqs [id] = seq;
+                                              }
+                                            }
+                         );
+              uniq = shellQuote (dir + "/hmm_query");
+              nUniq = newSeqs. size ();
+            }
+            if (! hitCache || nUniq)
+            {
+              if (t > 1 && nUniq > t / 2)  // PAR
               {
-                found = true;
-                break;
+                createDirectory (dir + "/hmm_chunk");
+                createDirectory (dir + "/hmmsearch_dir");
+                createDirectory (dir + "/dom_dir");
+                const size_t chunks = searchChunks (unQuote (uniq), t, dir + "/hmm_chunk", [this, &dir] (size_t chunk, const string &chunkFName)
+                  { const string item (to_string (chunk));
+                    exec (fullProg ("hmmsearch") 
+                          + "  --tblout "    + dir + "/hmmsearch_dir/" + item + "  --noali"
+                          + "  --domtblout " + dir + "/dom_dir/"       + item + "  --cut_tc  -Z 10000  --cpu 0  " + tmp + "/db/AMR.LIB" + " " + chunkFName + " > /dev/null 2> /dev/null"
+                         );
+                  });
+                concatChunks (dir + "/hmmsearch_dir", chunks, hmmsearch_out);
+                concatChunks (dir + "/dom_dir",       chunks, dom_out);
               }
+              else
+                exec (fullProg ("hmmsearch") + " --tblout " + hmmsearch_out + "  --noali  --domtblout " + dom_out + "  --cut_tc  -Z 10000  --cpu " + to_string (t - 1) + "  " + tmp + "/db/AMR.LIB" + " " + uniq + " > /dev/null 2> /dev/null");
             }
-            if (found)
+            if (hitCache)
             {
-         			const Chronometer_OnePass_cerr cop (blastx + " (for susceptible)");
-              const string tblastn_par (string (Seq_sp::Hsp::blastp_slow) + "  -window_size 15  -threshold 100  -db_gencode " + to_string (gencode));  // SB-3643, PD-4522
-        			findProg ("tblastn");
-        			exec (fullProg ("tblastn") + "  -subject " + dna_flat + "  -query " + tmp + "/db/AMRProt-susceptible.fa"
-            			  + tblastn_par + Seq_sp::Hsp::format_par (true) + "  -out " + tmp + "/blastx-slow > /dev/null 2> " + tmp + "/tblastn-slow-err", tmp + "/tblastn-slow-err");
-              slowBlastx = true;
+              // Cached hits are appended
+              OFStream hmmsearchF (hmmsearch);
+              OFStream domF       (dom);
+              for (const bool tbl : {true, false})
+              {
+                if (! nUniq)
+                  break;
+                LineInput f (tbl ? hmmsearch_out : dom_out);
+                while (f. nextLine ())
+                {
+                  (tbl ? hmmsearchF : domF) << f. line << '\n';
+                  if (f. line. empty () || f. line [0] == '#')
+                    continue;
+                  const size_t end = f. line. find_first_of (" \t");
+                  QC_ASSERT (end != string::npos);
+                  const string id (f. line. substr (0, end));
+                  if (! contains (newSeqs, id))
+                    throw runtime_error ("Unknown protein id in hmmsearch output:\n" + f. line);
+                  id2lines [id] << (tbl ? 'T' : 'D') + f. line. substr (end);
+                }
+              }
+              hitCache->put ("hmmsearch", newSeqs, id2lines);
+              for (const string& id : cachedIds)
+                for (const string& line : id2lines [id])
+                {
+                  QC_ASSERT (! line. empty ());
+                  (line [0] == 'T' ? hmmsearchF : domF) << id << line. substr (1) << '\n';
+                }
+            }
+            if (dedup. redundant ())
+            {
+              dedup. fanOut (hmmsearch, false, dir + "/hmmsearch");
+              dedup. fanOut (dom,       false, dir + "/dom");
             }
-          }          
+          });
+      };
+    // Max. length of AMRProt sequences, for blastx windows
+    size_t refLen_max = 0;
+    once_flag refLen_max_once;
+    const auto addBlastx = [&] (StageGraph &graph,
+                                size_t t,
+                                const string &query,
+                                const string &dir)
+      // Return: Stage index
+      // Input: query: quoted
+      // Output: dir + "/blastx"
+      {
+        const string blastx_par (string (Seq_sp::Hsp::blastp_fast) + "  -query_gencode " + to_string (gencode));
+          // Was: -word_size 3
+        const string cmd (fullProg ("blastx") + "  -query " + query + " -db " + tmp + "/db/AMRProt.fa" + "  "
+                          + blastx_par + Seq_sp::Hsp::format_par (false) + " " + blastThreadsParam ("blastx", t)
+                          + " -out " + dir + "/blastx > /dev/null 2> " + dir + "/blastx-err");
+        return graph. add ("blastx", t, [this, t, cmd, blastx_par, query, dir, blastx_windows, &refLen_max, &refLen_max_once] () 
+          { const Chronometer_OnePass_cerr cop ("blastx");
+            if (blastx_windows && packable (query))
+            {
+              call_once (refLen_max_once, [this, &refLen_max] () 
+                { forEachSeq (tmp + "/db/AMRProt.fa", [&refLen_max] (const string &/*id*/, const string &seq, const string &/*record*/) 
+                    { maximize (refLen_max, seq. size ()); }); 
+                });
+              // Contigs are split into overlapping windows searched in parallel
+              const size_t hitLen_max = 4 * refLen_max;  // PAR: nucleotides, with frameshifts and gaps
+              const size_t overlap = 2 * hitLen_max;
+              // Does not depend on t: the same windows for any number of threads
+              // Not longer than blastxDnaLen_max unless AMRProt.fa has a protein longer than blastxDnaLen_max / 32 aa
+              const size_t window_len = max (4 * overlap, blastxDnaLen_max);
+              const Vector<DnaWindow> windows (dna2windows (unQuote (query), window_len, overlap, dir + "/blastx_windows"));
+              if (windows. size () > 1)
+              {
+                createDirectory (dir + "/blastx_chunk");
+                createDirectory (dir + "/blastx_dir.err");
+                map<size_t/*chunk*/,StringVector> outputs;
+                mutex outputsMtx;
+                searchChunks (dir + "/blastx_windows", t, dir + "/blastx_chunk", [this, &blastx_par, &dir, &windows, &outputs, &outputsMtx] (size_t chunk, const string &chunkFName)
+                  { StringVector output;
+                    const string errFName (dir + "/blastx_dir.err/" + to_string (chunk));
+                    execLines (fullProg ("blastx") + "  -query " + chunkFName + " -db " + tmp + "/db/AMRProt.fa" + "  "
+                                 + blastx_par + Seq_sp::Hsp::format_par (false) + " 2> " + errFName,
+                               [&output, &windows] (const string &line) 
+                                 { string s (line);
+                                   if (blastxWindow2contig (s, windows))
+                                     output << std::move (s); 
+                                 },
+                               errFName);
+                    const lock_guard<mutex> lg (outputsMtx);
+                    outputs [chunk] = std::move (output);
+                  });
+                OFStream f (dir + "/blastx");
+                for (const auto& it : outputs)
+                  for (const string& line : it. second)
+                    f << line << '\n';
+                return;
+              }
+            }
+            exec (cmd, dir + "/blastx-err"); 
+          });
+      };
+
+
+    const auto addStages = [&] (StageGraph &graph,
+                                Sample &s,
+                                const Vector<size_t> &threads,
+                                size_t &stageNum,
+                                const Vector<size_t> &protPackStages,
+                                const Vector<size_t> &blastxPackStages)
+      // Searches meet only in amr_report and dna_mutation
+      // Input: threads: from requestSearches()
+      //        protPackStages, blastxPackStages: demultiplexing of the packed searches
+      // Update: stageNum: index in threads
+      // Output: s.amrReportRes
+      {
+        Vector<size_t> amr_report_prerequisites;
+        Vector<size_t> dna_mutation_prerequisites;
+        
+        if (s. protSearch)
+        {
+          if (s. protPacked)
+            amr_report_prerequisites << protPackStages;
+          else
+          {
+            amr_report_prerequisites << addBlastp (graph, threads [stageNum++], s. prot1, s. dir);
+            amr_report_prerequisites << addHmmsearch (graph, threads [stageNum++], s. prot1, s. nProt, s. dir);
+          }
+        }
+        if (! s. blastx. empty ())
+        {
+          if (s. blastxPacked)
+          {
+            ASSERT (s. blastx == "blastx");
+            amr_report_prerequisites << blastxPackStages;
+          }
+          else if (s. blastx == "blastx")
+            amr_report_prerequisites << addBlastx (graph, threads [stageNum++], s. dna_flat, s. dir);
+          else
+          {
+            ASSERT (s. blastx == "tblastn");
+            const size_t t = threads [stageNum++];
+            const string tblastn_par (string (Seq_sp::Hsp::blastp_fast) + "  -task tblastn-fast  -window_size 15  -threshold 100  -db_gencode " + to_string (gencode));  // SB-3643, PD-4522
+            amr_report_prerequisites << graph. add ("tblastn", t, [this, t, tblastn_par, &s, &db] () 
+              { const Chronometer_OnePass_cerr cop ("tblastn");
+                if (t > 1)
+                {
+                  createDirectory (s. dir + "/AMRProt_chunk");
+                  createDirectory (s. dir + "/tblastn_dir.err");
+                  // Chunk outputs are streamed into memory, no concatTextDir()
+                  map<size_t/*chunk*/,StringVector> outputs;
+                  mutex outputsMtx;
+                  searchChunks (db + "/AMRProt.fa", t, s. dir + "/AMRProt_chunk", [this, &tblastn_par, &s, &outputs, &outputsMtx] (size_t chunk, const string &chunkFName)
+                    { StringVector output;
+                      execLines (fullProg ("tblastn") + "  -subject " + s. dna_flat + "  -query " + chunkFName + "  "
+                                   + tblastn_par + Seq_sp::Hsp::format_par (true) + " 2> " + s. dir + "/tblastn_dir.err/" + to_string (chunk),
+                                 [&output] (const string &line) { output << line; });
+                      const lock_guard<mutex> lg (outputsMtx);
+                      outputs [chunk] = std::move (output);
+                    });
+                  OFStream f (s. dir + "/blastx");
+                  for (const auto& it : outputs)
+                    for (const string& line : it. second)
+                      f << line << '\n';
+                //concatTextDir (s. dir + "/tblastn_dir.err", s. dir + "/tblastn-err");
+                }
+                else
+                  exec (fullProg ("tblastn") + "  -subject " + s. dna_flat + "  -query " + tmp + "/db/AMRProt.fa  "
+                        + tblastn_par + Seq_sp::Hsp::format_par (true) + "  -out " + s. dir + "/blastx > /dev/null 2> " + s. dir + "/tblastn-err", s. dir + "/tblastn-err");
+              });
+          }
+        }
+        if (s. slowBlastx)
+        {
+          const size_t t = threads [stageNum++];
+          const string tblastn_par (string (Seq_sp::Hsp::blastp_slow) + "  -window_size 15  -threshold 100  -db_gencode " + to_string (gencode));  // SB-3643, PD-4522
+          const string cmd (fullProg ("tblastn") + "  -subject " + s. dna_flat + "  -query " + tmp + "/db/AMRProt-susceptible.fa"
+                            + tblastn_par + Seq_sp::Hsp::format_par (true) + "  -out " + s. dir + "/blastx-slow > /dev/null 2> " + s. dir + "/tblastn-slow-err");
+          amr_report_prerequisites << graph. add ("tblastn (for susceptible)", t, [cmd, &s] () 
+            { const Chronometer_OnePass_cerr cop (s. blastx + " (for susceptible)");
+              exec (cmd, s. dir + "/tblastn-slow-err"); 
+            });
+        }
+        if (s. blastn)
+        {
+          const size_t t = threads [stageNum++];
+          const string cmd (fullProg ("blastn") + " -query " + s. dna_flat + " -db " + tmp + "/db/AMR_DNA-" + s. organism1 + ".fa  -evalue 1e-20  -dust no  -max_target_seqs 10000  " 
+                            + Seq_sp::Hsp::format_par (false) + " -out " + s. dir + "/blastn > " + s. dir + "/blastn-log 2> " + s. dir + "/blastn-err");
+                              // SB-4472
+          dna_mutation_prerequisites << graph. add ("blastn", t, [cmd, &s] () 
+            { const Chronometer_OnePass_cerr cop ("blastn");
+              exec (cmd, s. dir + "/blastn-err"); 
+            });
+        }
+        if (s. stxTyper)
+        {
+          const size_t t = threads [stageNum++];
+          const string stxLogFName (s. dir + "/stxtyper-log");
+          const string cmd (  fullProg ("stxtyper") 
+                            + "  -n " + s. dna_flat 
+                            + prependS (blast_bin, "  --blast_bin ") 
+                            + "  -o " + s. dir + "/stxtyper"
+                            + "  --name " + s. name 
+                            + "  --amrfinder"
+                            + ifS (print_node, "  --print_node")
+                            + "  -q "  // ifS (getVerbosity () == -1, "  -q")
+                            + ifS (qc_on, "  --debug")
+                            + "  --threads " + to_string (t)  
+                            + " > " + stxLogFName
+                           );
+          graph. add ("stxtyper", t, [cmd, stxLogFName] () 
+            { const Chronometer_OnePass_cerr cop ("stxtyper");
+              exec (cmd, stxLogFName); 
+            });
+        }
 
-          if (blastn)
-      		{
-      			findProg ("blastn");
-      			stderr. section ("Running blastn");
-       			const Chronometer_OnePass_cerr cop ("blastn");
-       	  #if 1
-      			exec (fullProg ("blastn") + " -query " + dna_flat + " -db " + tmp + "/db/AMR_DNA-" + organism1 + ".fa  -evalue 1e-20  -dust no  -max_target_seqs 10000  " 
-      			      + /*getBlastThreadsParam ("blastn", min (nDna, dnaLen_total / 2500000)) +*/ Seq_sp::Hsp::format_par (false) + " -out " + tmp + "/blastn > " + logFName + " 2> " + tmp + "/blastn-err", tmp + "/blastn-log");
-      			        // SB-4472
-      		#else
-      		  execSpeed (  fullProg ("blastn") + " -query " + dna_flat + " -db " + tmp + "/db/AMR_DNA-" + organism1 + ".fa  -evalue 1e-20  -dust no  -max_target_seqs 10000  "
-      		               + Seq_sp::Hsp::format_par (false) + " -out " + tmp + "/blastn"
-      		             , getBlastThreadsParam ("blastn", min (nDna, dnaLen_total / 2500000))
-      		             , logFName
-      		             , tmp + "/blastn-err"
-      		             , tmp + "/blastn-log"
-      		             );
-      		#endif
-      		}
-    		}
-    		else
+        // s.amrReportRes
+        const string nameS (" -name " + s. name);
+        {
+          AmrReport par (s. amrReportPar);
+          par. famFName             = db + "/fam.tsv";
+          par. organism             = s. organism1;
+          par. mutation_tab         = db + "/AMRProt-mutation.tsv";
+          par. susceptible_tab      = db + "/AMRProt-susceptible.tsv";
+          par. mutation_all         = ! s. mutation_all. empty ();
+          par. force_cds_report     = ! emptyArg (s. dna) && ! s. organism1. empty ();  // Needed for dna_mutation
+          par. report_core_only     = ! add_plus;
+          par. equidistant          = equidistant;
+          par. print_node           = print_node;
+          par. ident_min            = ident;
+          par. partial_coverage_min = cov;
+          if (s. suppress_common)
+            par. suppress_prot_FName = s. dir + "/suppress_prot";
+          par. name                 = unQuote (s. name);
+          par. threads              = threads_max;
+            // Not in splitThreads(): the searches of s are finished, amrReport() invocations are serialized
+          parm2amrReport (parm, par);
+          graph. add ("amr_report", 1, [par, &s] () 
+            { if (s. slowBlastx)
+            	{
+                ofstream f (s. dir + "/blastx", ios_base::app);
+                copyText (s. dir + "/blastx-slow", 0, f);
+            	}
+            	const Chronometer_OnePass_cerr cop ("amr_report");
+              amrReport (par, s. amrReportRes);
+            }
+            , amr_report_prerequisites);
+        }
+    		if (s. blastn)
     		{
-  		    OFStream::create (tmp + "/blastx");
-  		    OFStream::create (tmp + "/len");
-      		if (blastn)
-    		    OFStream::create (tmp + "/blastn");
-  		  }
-   		  amr_report_blastx = "-blastx " + tmp + "/blastx  -dna_len " + tmp + "/len";
-  		}
-  	}
-  	
-  	
-  	if (hmmChunks)
-  	{
-  	  concatTextDir (tmp + "/hmmsearch_dir", tmp + "/hmmsearch");
-  	  concatTextDir (tmp + "/dom_dir",       tmp + "/dom");
-  	}
-
-  	if (tblastnChunks)
-  	{
-  	  concatTextDir (tmp + "/tblastn_dir",     tmp + "/blastx");
-  	//concatTextDir (tmp + "/tblastn_dir.err", tmp + "/tblastn-err");
-  	}
-  	
-  	if (slowBlastx)
-  	{
-      ofstream f (tmp + "/blastx", ios_base::app);
-      copyText (tmp + "/blastx-slow", 0, f);
-  	}
-
-
-  	if (suppress_common)
-  	{
-			OFStream outF (tmp + "/suppress_prot");
-			LineInput f (db + "/AMRProt-suppress.tsv");
-			while (f. nextLine ())
-			  if (! isLeft (f. line, "#"))
-  			{
-  			  string org, accver;
-  			  istringstream iss (f. line);
-  			  iss >> org >> accver;
-  			  QC_ASSERT (! accver. empty ());
-  			  if (org == organism1)
-  			    outF << accver << endl;
-  			}
-	  }
-		
-		
-	  if (stxTyper)
-	  {
-  		stderr. section ("Running stxtyper");
- 			const Chronometer_OnePass_cerr cop ("stxtyper");
- 			ASSERT (threads_max >= 1);
-			exec (  fullProg ("stxtyper") 
-			      + "  -n " + dna_flat 
-			      + prependS (blast_bin, "  --blast_bin ") 
-			      + "  -o " + tmp + "/stxtyper"
-			      + "  --name " + input_name 
-			      + "  --amrfinder"
-			      + ifS (print_node, "  --print_node")
-			      + "  -q "  // ifS (getVerbosity () == -1, "  -q")
-			      + ifS (qc_on, "  --debug")
-			      + "  --threads " + to_string (threads_max )  
-			      + " > " + logFName
-			      , logFName
-			      );
-	  }
-		
+          const string mutation_allS (s. mutation_all. empty () ? "" : ("-mutation_all " + s. dir + "/mutation_all.dna")); 
+          const string dnaMutLogFName (s. dir + "/dna_mutation-log");
+    			const string cmd (fullProg ("dna_mutation") + s. dir + "/blastn " + shellQuote (db + "/AMR_DNA-" + s. organism1 + ".tsv") + " " + strQuote (s. organism1) + " " + mutation_allS 
+    			                  + nameS + printNode + qcS + " -log " + dnaMutLogFName + " > " + s. dir + "/amr-snp");
+          graph. add ("dna_mutation", 1, [cmd, dnaMutLogFName] () 
+            { const Chronometer_OnePass_cerr cop ("dna_mutation");
+              exec (cmd, dnaMutLogFName);
+            }
+            , dna_mutation_prerequisites);
+    	  }
+      };
+      
 
-    // tmp + "/amr", tmp + "/mutation_all"
-		stderr. section ("Making report");
-    const string printNode (print_node ? " -print_node" : "");
-    const string nameS (" -name " + input_name);
-    {
- 			const Chronometer_OnePass_cerr cop ("amr_report");
-      const string mutation_allS (mutation_all. empty () ? "" : ("-mutation_all " + tmp + "/mutation_all"));      
-      const string coreS (add_plus ? "" : " -core");
-  		const string force_cds_report (! emptyArg (dna) && ! organism1. empty () ? "-force_cds_report" : "");  // Needed for dna_mutation
-      const string equidistantS (equidistant ? " -report_equidistant" : "");
-  		exec (fullProg ("amr_report") + " -fam " + shellQuote (db + "/fam.tsv") + "  " + amr_report_blastp + "  " + amr_report_blastx
-      		  + "  -organism " + strQuote (organism1) 
-      		  + "  -mutation "    + shellQuote (db + "/AMRProt-mutation.tsv") 
-      		  + "  -susceptible " + shellQuote (db + "/AMRProt-susceptible.tsv") 
-      		  + " " + mutation_allS + " "
-      		  + force_cds_report + coreS + equidistantS + printNode  // + " -pseudo"
-      		  + (ident == -1 ? noString : "  -ident_min "    + toString (ident)) 
-      		  + "  -coverage_min " + toString (cov)
-      		  + ifS (suppress_common, " -suppress_prot " + tmp + "/suppress_prot")  
-      		  + nameS + qcS + " " + parm + " -log " + logFName + " > " + tmp + "/amr", logFName);
-  	}
-		if (blastn)
-		{
- 			const Chronometer_OnePass_cerr cop ("dna_mutation");
-      const string mutation_allS (mutation_all. empty () ? "" : ("-mutation_all " + tmp + "/mutation_all.dna")); 
-			exec (fullProg ("dna_mutation") + tmp + "/blastn " + shellQuote (db + "/AMR_DNA-" + organism1 + ".tsv") + " " + strQuote (organism1) + " " + mutation_allS 
-			      + nameS + printNode + qcS + " -log " + logFName + " > " + tmp + "/amr-snp", logFName);
-	    {
-  			ofstream f (tmp + "/amr", ios_base::out | ios_base::app);
-  			copyText (tmp + "/amr-snp", 1, f);
-  	  }
-      if (! mutation_all. empty ())
+    const auto finishSample = [&] (Sample &s)
+      // Input: s.amrReportRes, destroyed
+      // Output: s.output, s.mutation_all
       {
-  			ofstream f (tmp + "/mutation_all", ios_base::out | ios_base::app);
-  			copyText (tmp + "/mutation_all.dna", 1, f);
-  	  }
-	  }
-	  if (stxTyper)
-    {
-			ofstream f (tmp + "/amr", ios_base::out | ios_base::app);
-			copyText (tmp + "/stxtyper", 1, f);
-	  }
+        TextTable amrTab (std::move (s. amrReportRes. report));
+        TextTable mutation_allTab (std::move (s. amrReportRes. mutation_all));
+        s. amrReportRes = std::move (AmrReportResult ());
+    		if (s. blastn)
+    		{
+    		  addRows (amrTab, s. dir + "/amr-snp");
+          if (! s. mutation_all. empty ())
+      		  addRows (mutation_allTab, s. dir + "/mutation_all.dna");
+    	  }
+    	  if (s. stxTyper)
+    		  addRows (amrTab, s. dir + "/stxtyper");
+
+
+        // Column names are from amr_report.cpp
+
+        // AMR report: sort, uniq, disruption genesymbols
+        // PD-2244, PD-3230
+        StringVector amrSortColumns;
+        if (! (emptyArg (s. dna) && emptyArg (s. gff)))
+          amrSortColumns << contig_colName << start_colName << stop_colName << strand_colName;    
+        amrSortColumns << prot_colName << genesymbol_colName;  
+        
+        {
+          if (! emptyArg (s. dna))
+          {
+     		    amrTab_disruptions (amrTab, db, s. dna_flat, gencode, qcS, s. dir);
+            const StringVector amrSortColumns_main {{contig_colName, strand_colName, genesymbol_colName}};
+            // Global for amrTab_equivBetter()
+            subtype_col = amrTab. col2num (subtype_colName);  
+            start_col   = amrTab. col2num (start_colName);  
+            stop_col    = amrTab. col2num (stop_colName);  
+            strand_col  = amrTab. col2num (strand_colName);  
+            //
+            amrTab. deredundify (amrSortColumns_main, amrTab_equivBetter);         
+          }
+          amrTab. sort (amrSortColumns);
+          amrTab. rows. uniq ();  // PD-4297    
+          amrTab. qc ();
+          if (qc_on)
+          {
+            const TextTable::ColNum genesymbolCol = amrTab. col2num (genesymbol_colName);
+            const TextTable::ColNum elemNameCol   = amrTab. col2num (elemName_colName);
+            for (const StringVector& row : amrTab. rows)
+            {
+              QC_ASSERT (row [genesymbolCol] != na);
+              QC_ASSERT (row [elemNameCol]   != na);
+            }
+          }
+          Cout out (s. output);
+     		  amrTab. saveText (*out);
+        }
 
+        // Sorting mutation_all
+        if (! s. mutation_all. empty ())
+        {
+          if (! emptyArg (s. dna))
+       		  amrTab_disruptions (mutation_allTab, db, s. dna_flat, gencode, qcS, s. dir);
+          mutation_allTab. sort (amrSortColumns);
+          mutation_allTab. rows. uniq ();
+          mutation_allTab. qc ();
+          mutation_allTab. saveFile (s. mutation_all);
+          if (qc_on)
+          {
+            const TextTable::ColNum i = mutation_allTab. col2num (subtype_colName);
+            for (const StringVector& row : mutation_allTab. rows)
+              QC_ASSERT (row [i] == "POINT");
+          }
+        }
+      };
 
-    // Column names are from amr_report.cpp
 
-    // AMR report: sort, uniq, disruption genesymbols
-    // PD-2244, PD-3230
+    // Samples are pipelined through the stages by blocks
+    const size_t block_size = batch. empty () ? 1 : 4 * threads_max;  // PAR
+    for (size_t start = 0; start < samples. size (); start += block_size)
     {
-      StringVector amrSortColumns;
-      if (! (emptyArg (dna) && emptyArg (gff)))
-        amrSortColumns << contig_colName << start_colName << stop_colName << strand_colName;    
-      amrSortColumns << prot_colName << genesymbol_colName;  
-      
+      const size_t end = min (start + block_size, samples. size ());
+      FOR_START (size_t, i, start, end)
       {
-        TextTable amrTab (tmp + "/amr");
-        if (! emptyArg (dna))
+        Sample& s = samples [i];
+        if (! batch. empty ())
         {
-   		    amrTab_disruptions (amrTab, db, dna_flat, gencode, qcS);
-          const StringVector amrSortColumns_main {{contig_colName, strand_colName, genesymbol_colName}};
-          // Global for amrTab_equivBetter()
-          subtype_col = amrTab. col2num (subtype_colName);  
-          start_col   = amrTab. col2num (start_colName);  
-          stop_col    = amrTab. col2num (stop_colName);  
-          strand_col  = amrTab. col2num (strand_colName);  
-          //
-          amrTab. deredundify (amrSortColumns_main, amrTab_equivBetter);         
+          stderr. section ("Sample " + unQuote (s. name) + " (" + to_string (i + 1) + "/" + to_string (samples. size ()) + ")");
+          createDirectory (s. dir);
         }
-        amrTab. sort (amrSortColumns);
-        amrTab. rows. uniq ();  // PD-4297    
-        amrTab. qc ();
-        if (qc_on)
+        prepareSample (s);
+      }
+
+      // Packing: the block's proteins and contigs are searched in one run
+      VectorPtr<Sample> protPack;
+      VectorPtr<Sample> blastxPack;
+      size_t protLen_pack = 0;
+      size_t nProt_pack = 0;
+      size_t dnaLen_pack = 0;
+      size_t nDna_pack = 0;
+      if (! batch. empty ())
+      {
+        FOR_START (size_t, i, start, end)
         {
-          const TextTable::ColNum genesymbolCol = amrTab. col2num (genesymbol_colName);
-          const TextTable::ColNum elemNameCol   = amrTab. col2num (elemName_colName);
-          for (const StringVector& row : amrTab. rows)
+          const Sample& s = samples [i];
+          if (s. protSearch && packable (s. prot1))
           {
-            QC_ASSERT (row [genesymbolCol] != na);
-            QC_ASSERT (row [elemNameCol]   != na);
+            protPack << & s;
+            protLen_pack += s. protLen_total;
+            nProt_pack   += s. nProt;
+          }
+          if (s. blastx == "blastx" && packable (s. dna_flat))
+          {
+            blastxPack << & s;
+            dnaLen_pack += s. dnaLen_total;
+            nDna_pack   += s. nDna;
           }
         }
-        Cout out (output);
-   		  amrTab. saveText (*out);
+        if (protPack. size () < 2)  // PAR
+          protPack. clear ();
+        if (blastxPack. size () < 2)  // PAR
+          blastxPack. clear ();
+        for (const Sample* s : protPack)
+          var_cast (s) -> protPacked = true;
+        for (const Sample* s : blastxPack)
+          var_cast (s) -> blastxPacked = true;
       }
 
-      // Sorting mutation_all
-      if (! mutation_all. empty ())
+      StringVector names;
+      Vector<size_t> requested;
+      if (! protPack. empty ())
       {
-        TextTable mutation_allTab (tmp + "/mutation_all");
-        if (! emptyArg (dna))
-     		  amrTab_disruptions (mutation_allTab, db, dna_flat, gencode, qcS);
-        mutation_allTab. sort (amrSortColumns);
-        mutation_allTab. rows. uniq ();
-        mutation_allTab. qc ();
-        mutation_allTab. saveFile (mutation_all);
-        if (qc_on)
+        names << "blastp" << "hmmsearch";
+        requested << max<size_t> (1, min<size_t> (nProt_pack, protLen_pack / 10000)) << threads_max;  // PAR
+      }
+      if (! blastxPack. empty ())
+      {
+        names << "blastx";
+        requested << max<size_t> (1, min<size_t> (nDna_pack + (blastx_windows ? dnaLen_pack / blastxDnaLen_max : 0), dnaLen_pack / 10002));  // PAR
+      }
+      FOR_START (size_t, i, start, end)
+        requestSearches (samples [i], names, requested);
+      const Vector<size_t> threads (splitThreads (requested, threads_max));
+      ASSERT (threads. size () == names. size ());
+
+      StageGraph graph (threads_max);
+      size_t stageNum = 0;
+      Vector<size_t> protPackStages;
+      Vector<size_t> blastxPackStages;
+      if (! protPack. empty () || ! blastxPack. empty ())
+      {
+        const string packDir (tmp + "/pack" + to_string (start));
+        createDirectory (packDir);
+        if (! protPack. empty ())
         {
-          const TextTable::ColNum i = mutation_allTab. col2num (subtype_colName);
-          for (const StringVector& row : mutation_allTab. rows)
-            QC_ASSERT (row [i] == "POINT");
+          packFasta (protPack, true, packDir + "/prot");
+          const size_t blastpStage    = addBlastp    (graph, threads [stageNum++], shellQuote (packDir + "/prot"), packDir);
+          const size_t hmmsearchStage = addHmmsearch (graph, threads [stageNum++], shellQuote (packDir + "/prot"), nProt_pack, packDir);
+          protPackStages << graph. add ("blastp demultiplexing", 1, [packDir, &protPack] () 
+                                          { demultiplex (packDir + "/blastp", true, protPack, "blastp"); }, 
+                                        Vector<size_t> {blastpStage});
+          protPackStages << graph. add ("hmmsearch demultiplexing", 1, [packDir, &protPack] () 
+                                          { demultiplex (packDir + "/hmmsearch", false, protPack, "hmmsearch"); 
+                                            demultiplex (packDir + "/dom",       false, protPack, "dom"); 
+                                          }, 
+                                        Vector<size_t> {hmmsearchStage});
         }
+        if (! blastxPack. empty ())
+        {
+          packFasta (blastxPack, false, packDir + "/dna");
+          const size_t blastxStage = addBlastx (graph, threads [stageNum++], shellQuote (packDir + "/dna"), packDir);
+          blastxPackStages << graph. add ("blastx demultiplexing", 1, [packDir, &blastxPack] () 
+                                            { demultiplex (packDir + "/blastx", true, blastxPack, "blastx"); }, 
+                                          Vector<size_t> {blastxStage});
+        }
+      }
+      FOR_START (size_t, i, start, end)
+        addStages (graph, samples [i], threads, stageNum, protPackStages, blastxPackStages);
+      ASSERT (stageNum == names. size ());
+
+      names. sort ();
+      names. uniq ();
+      if (! names. empty ())
+        stderr. section ("Running " + names. toString (", "));
+      graph. run ();
+
+      stderr. section ("Making report");
+      FOR_START (size_t, i, start, end)
+      {
+        finishSample (samples [i]);
+        if (! batch. empty () && ! logPtr)
+          removeDirectory (samples [i]. dir);
       }
     }
 
 
+    if (! batch. empty ())
+    {
+      // Combined reports
+      // Columns of a report depend on the input files of the sample
+      const auto combine = [&samples] (const string &outFName, 
+                                       bool mutation_allP)
+        { const auto fName = [mutation_allP] (const Sample &s) -> const string& 
+            { return mutation_allP ? s. mutation_all : s. output; };
+          StringVector header;
+          for (const Sample& s : samples)
+          {
+            LineInput f (fName (s));
+            if (! f. nextLine ())
+              throw runtime_error ("Empty report file " + strQuote (fName (s)));
+            const StringVector columns (f. line, '\t', true);
+            size_t pos = 0;
+            for (const string& column : columns)
+            {
+              const size_t i = header. indexOf (column);
+              if (i == no_index)
+              {
+                header. insert (header. begin () + (long) pos, column);
+                pos++;
+              }
+              else
+                pos = i + 1;
+            }
+          }
+          Cout out (outFName);
+          *out << header. toString ("\t") << endl;
+          for (const Sample& s : samples)
+          {
+            LineInput f (fName (s));
+            EXEC_ASSERT (f. nextLine ());
+            const StringVector columns (f. line, '\t', true);
+            Vector<size_t> header2column (header. size (), no_index);
+            FFOR (size_t, i, columns. size ())
+              header2column [header. indexOf (columns [i])] = i;
+            while (f. nextLine ())
+            {
+              const StringVector row (f. line, '\t', true);
+              QC_ASSERT (row. size () == columns. size ());
+              FFOR (size_t, i, header. size ())
+              {
+                if (i)
+                  *out << '\t';
+                *out << (header2column [i] == no_index ? na : row [header2column [i]]);
+              }
+              *out << endl;
+            }
+          }
+        };
+      combine (output, false);
+      if (! mutation_all. empty ())
+        combine (mutation_all, true);
+      return;
+    }
+
+
+    const Sample& sample = samples. front ();
+    const string& prot_flat = sample. prot_flat;
+    const string& dna_flat  = sample. dna_flat;
+
     if (! emptyArg (prot_out))
     {
       prepare_fasta_extract (StringVector {prot_colName, genesymbol_colName, elemName_colName}, "prot_out", false);
@@ -45,6 +45,10 @@
 #undef NDEBUG 
 #include "common.hpp"
 using namespace Common_sp;
+#include "seq.hpp"
+using namespace Seq_sp;
+#include "dbsnapshot.hpp"
+using namespace DbSnapshot_sp;
 
 #include "common.inc"
 
@@ -55,6 +59,26 @@ namespace
 {
 
 
+
+bool refInFam (string sseqid)
+// Return: reference protein is not a mutation or susceptible protein and is not a part of a fusion
+// Input: sseqid: format: see amr_report.cpp
+{
+  rfindSplit (sseqid, '|');  // product
+  rfindSplit (sseqid, '|');  // class
+  rfindSplit (sseqid, '|');  // subclass
+  rfindSplit (sseqid, '|');  // reportable
+  const string resistance (rfindSplit (sseqid, '|'));
+  rfindSplit (sseqid, '|');  // gene
+  rfindSplit (sseqid, '|');  // famId
+  const string parts (rfindSplit (sseqid, '|'));
+  return    resistance != "mutation"
+         && resistance != "susceptible"
+         && parts == "1";
+}
+
+
+
 	
 // ThisApplication
 
@@ -71,6 +95,104 @@ struct ThisApplication final : ShellApplication
 
 
 
+  void indexExact (const string &dbDir,
+                   const string &tmpDir) const
+  // Output: dbDir + "AMRProt-exact.tsv": {<sequence> \t <BLAST sseqid> <eol>}*
+  //           lines of a sequence are in the BLAST order
+  //           a protein identical to <sequence> has the same best BLAST hits as <sequence>:
+  //             the identical AMRProt.fa proteins, which are in families and are not fusion parts
+  // Requires: BLAST database of AMRProt.fa
+  {
+    // Distinct sequences of AMRProt.fa
+    StringVector seqs;
+    {
+      Set<string> seqSet;
+      LineInput f (dbDir + "AMRProt.fa");
+      string seq;
+      for (;;)
+      {
+        const bool eof = ! f. nextLine ();
+        if (eof || isLeft (f. line, ">"))
+        {
+          if (! seq. empty ())
+            seqSet << std::move (seq);
+          seq. clear ();
+          if (eof)
+            break;
+        }
+        else
+          seq += f. line;
+      }
+      seqs. reserve (seqSet. size ());
+      for (const string& s : seqSet)
+        seqs << s;
+    }
+    {
+      OFStream f (tmpDir + "/exact.fa");
+      FFOR (size_t, i, seqs. size ())
+        f << '>' << i << '\n' << seqs [i] << '\n';
+    }
+  
+    // Must be the same as in amrfinder.cpp
+    exec (fullProg ("blastp") + " -query " + tmpDir + "/exact.fa  -db " + tmpDir + "/db/AMRProt.fa" 
+          + Hsp::blastp_fast + " -task blastp-fast" + Hsp::format_par (false) + " -out " + tmpDir + "/exact.blastp > /dev/null 2> " + tmpDir + "/exact.blastp-err", tmpDir + "/exact.blastp-err");
+
+    Vector<StringVector> seq2refs (seqs. size ());
+      // Identical references in the BLAST order
+    Vector<bool> good (seqs. size (), true);
+    FFOR (size_t, i, seqs. size ())
+      for (const char c : seqs [i])
+        if (! charInSet (c, "ACDEFGHIKLMNPQRSTVWY"))
+        {
+          good [i] = false;
+          break;
+        }
+    {
+      LineInput f (tmpDir + "/exact.blastp");
+      Istringstream iss;
+      while (f. nextLine ())
+      {
+        string sseqid, sseq, qseq;
+        size_t i, sstart, send, slen, qstart, qend, qlen;
+        iss. reset (f. line);
+        iss >> sseqid >> i >> sstart >> send >> slen >> qstart >> qend >> qlen >> sseq >> qseq;
+        QC_ASSERT (i < seqs. size ());
+        QC_ASSERT (sseq. size () == qseq. size ());
+        if (! good [i])
+          continue;
+        if (! refInFam (sseqid))
+        {
+          good [i] = false;
+          continue;
+        }
+        if (   sstart == 1 && send == slen
+            && qstart == 1 && qend == qlen
+            && slen == qlen
+            && sseq == qseq
+           )
+          seq2refs [i] << sseqid;
+        else
+        {
+          // Not dominated by the identical references if nident = qlen
+          size_t nident = 0;
+          FFOR (size_t, j, sseq. size ())
+            if (sseq [j] == qseq [j] && sseq [j] != '-')
+              nident++;
+          if (nident >= qlen)
+            good [i] = false;
+        }
+      }
+    }
+  
+    OFStream f (dbDir + "AMRProt-exact.tsv");
+    FFOR (size_t, i, seqs. size ())
+      if (good [i])
+        for (const string& sseqid : seq2refs [i])
+          f << seqs [i] << '\t' << sseqid << '\n';
+  }
+
+
+
   void shellBody () const final
   {
     string dbDir     = getArg ("DATABASE");
@@ -92,6 +214,10 @@ struct ThisApplication final : ShellApplication
       prog2dir ["makeblastdb"] = blast_bin;
     findProg ("makeblastdb");    
 
+    if (! blast_bin. empty ())
+      prog2dir ["blastp"] = blast_bin;
+    findProg ("blastp");    
+
     if (! hmmer_bin. empty ())
       prog2dir ["hmmpress"] = hmmer_bin;
     findProg ("hmmpress");
@@ -122,6 +248,25 @@ struct ThisApplication final : ShellApplication
 	  exec (fullProg ("makeblastdb") + " -in " + tmp + "/db/AMR_CDS.fa" + "  -dbtype nucl  -logfile " + tmp + "/makeblastdb.AMR_CDS", tmp + "/makeblastdb.AMR_CDS");  
     for (const string& dnaPointMut : dnaPointMuts)
   	  exec (fullProg ("makeblastdb") + " -in " + tmp + "/db/AMR_DNA-" + dnaPointMut + ".fa  -dbtype nucl  -logfile " + tmp + "/makeblastdb.AMR_DNA-" + dnaPointMut, tmp + "/makeblastdb.AMR_DNA-" + dnaPointMut);
+  	  
+    stderr. section ("Indexing exact matches");
+  	indexExact (dbDir, tmp);
+
+    stderr. section ("Indexing tables");
+    {
+      DbSnapshot snapshot;
+      snapshot. fams.         set (dbDir + "fam.tsv",                  readFams         (dbDir + "fam.tsv"));
+      snapshot. mutations.    set (dbDir + "AMRProt-mutation.tsv",     readMutations    (dbDir + "AMRProt-mutation.tsv", true));
+      snapshot. susceptibles. set (dbDir + "AMRProt-susceptible.tsv",  readSusceptibles (dbDir + "AMRProt-susceptible.tsv"));
+      for (const string& dnaPointMut : dnaPointMuts)
+      {
+        const string fName (dbDir + "AMR_DNA-" + dnaPointMut + ".tsv");
+        Table<MutationRow> table;
+        table. set (fName, readMutations (fName, false));
+        snapshot. dnaMutations << std::move (table);
+      }
+      snapshot. save (dbDir);
+    }
   }
 };
 
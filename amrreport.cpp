@@ -0,0 +1,3152 @@
+// amrreport.cpp
+
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE                          
+*               National Center for Biotechnology Information
+*                                                                          
+*  This software/database is a "United States Government Work" under the   
+*  terms of the United States Copyright Act.  It was written as part of    
+*  the author's official duties as a United States Government employee and 
+*  thus cannot be copyrighted.  This software/database is freely available 
+*  to the public for use. The National Library of Medicine and the U.S.    
+*  Government have not placed any restriction on its use or reproduction.  
+*                                                                          
+*  Although all reasonable efforts have been taken to ensure the accuracy  
+*  and reliability of the software and data, the NLM and the U.S.          
+*  Government do not and cannot warrant the performance or results that    
+*  may be obtained by using this software or data. The NLM and the U.S.    
+*  Government disclaim all warranties, express or implied, including       
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.                                                                
+*                                                                          
+*  Please cite the author in any work or product based on this material.   
+*
+* ===========================================================================
+*
+* Author: Vyacheslav Brover
+*
+* File Description:
+*   Identification of AMR genes using BLAST and HMM search results vs. the AMRFinderPlus database
+*
+*/
+   
+   
+
+#undef NDEBUG 
+
+#include "amrreport.hpp"
+#include "seq.hpp"
+using namespace Seq_sp;
+#include "alignment.hpp"
+using namespace Alignment_sp;
+#include "columns.hpp"
+#include "dbsnapshot.hpp"
+using namespace DbSnapshot_sp;
+
+#include <atomic>
+
+#include "common.inc"
+
+
+
+namespace 
+{
+
+
+// Global
+
+// PAR
+constexpr bool useCrossOrigin = false;  // GPipe: true
+constexpr double frac_delta = 1e-5;  
+  
+bool ident_min_user = false;
+bool equidistant = false;
+bool cdsExist = false;
+bool print_node = false;
+bool print_node_raw = false;
+//bool reportPseudo = false; 
+bool targetProt = true;
+string input_name;
+bool paretoUngrouped = false;
+
+//const string stopCodonS ("[stop]");
+//const string frameShiftS ("[frameshift]");
+
+unordered_map <string/*accession*/, Vector<AmrMutation>>  accession2mutations;
+
+
+
+struct BlastRule final : Root
+// PD-2310
+{
+  // 0 <=> undefined
+  // 0 .. 1
+  double ident {0.0};
+    // Of alignment
+  double target_coverage {0.0};  // Not used
+  double ref_coverage {0.0};
+
+
+  BlastRule (double ident_arg,
+             double ref_coverage_arg)
+    : ident        (ident_arg)
+    , ref_coverage (ref_coverage_arg)
+    {
+      QC_ASSERT (ident > 0.0);
+      QC_ASSERT (ident <= 1.0);
+      QC_ASSERT (target_coverage >= 0.0);
+      QC_ASSERT (target_coverage <= 1.0);
+      QC_ASSERT (ref_coverage > 0.0);
+      QC_ASSERT (ref_coverage <= 1.0);
+    }  
+  BlastRule () = default;
+  void saveText (ostream &os) const final
+    { os << ident << ' ' << ref_coverage; }
+  bool empty () const final
+    { return ! ident; }
+};
+
+BlastRule defaultCompleteBR;
+BlastRule defaultPartialBR;
+
+
+
+struct Fam 
+// Table PROTEUS.VF..FAM
+{
+	const Fam* parent {nullptr};
+	  // Tree
+  string id; 
+  string genesymbol;
+  string familyName; 
+  uchar reportable {0}; 
+    // 0,1,2
+
+  // HMM
+  string hmm; 
+    // May be empty()
+  double tc1 {NaN}; 
+  double tc2 {NaN}; 
+
+  // BlastRule's
+  BlastRule completeBR;
+  BlastRule partialBR;
+  
+  string type;
+  string subtype;
+  string classS;
+  string subclass;
+
+
+  Fam (const string &id_arg,
+       const string &genesymbol_arg,
+       const string &hmm_arg,
+       double tc1_arg,
+       double tc2_arg,
+       const BlastRule &completeBR_arg,
+       const BlastRule &partialBR_arg,
+       const string &type_arg,
+       const string &subtype_arg,
+       const string &class_arg,
+       const string &subclass_arg,
+       const string &familyName_arg,
+       uchar reportable_arg)
+    : id (id_arg)
+    , genesymbol (genesymbol_arg)
+    , familyName (familyName_arg)
+    , reportable (reportable_arg)
+    , hmm (hmm_arg)
+    , tc1 (tc1_arg)
+    , tc2 (tc2_arg)
+    , completeBR (completeBR_arg)
+    , partialBR (partialBR_arg)
+    , type (type_arg)
+    , subtype (subtype_arg)
+    , classS (class_arg)
+    , subclass (subclass_arg)
+    { if (genesymbol == "-")
+        genesymbol. clear ();
+      if (hmm == "-")
+        hmm. clear ();
+      QC_ASSERT (hmm. empty () == ! tc1);
+      QC_ASSERT (hmm. empty () == ! tc2); 
+    //IMPLY (! hmm. empty (), tc2 > 0);
+      if (familyName == "NULL")
+        familyName. clear ();
+      QC_ASSERT (tc2 >= 0.0);        
+      QC_ASSERT (tc2 <= tc1);
+      QC_ASSERT (! completeBR. empty ())
+      QC_ASSERT (! partialBR. empty ());
+    }
+  Fam () = default;
+  void saveText (ostream &os) const 
+    { os << hmm << " " << tc1 << " " << tc2 << " " << familyName << " " << (int) reportable; }
+
+
+	bool descendantOf (const Fam* ancestor) const
+	  { if (! ancestor)
+	  	  return true;
+	  	if (this == ancestor)
+	  		return true;
+	  	if (parent)
+	  		return parent->descendantOf (ancestor);
+	  	return false;
+	  }
+  const Fam* getHmmFam () const
+    // Return: most specific HMM
+    { const Fam* f = this;
+      while (f && f->hmm. empty ())
+        f = f->parent;
+      return f;
+    }
+};
+
+
+
+unordered_map<string/*famId*/,const Fam*> famId2fam;
+  // Value: !nullptr
+unordered_map<string/*hmm*/,const Fam*> hmm2fam;
+
+// Reference data: famId2fam, hmm2fam, accession2mutations, accession2susceptible, alien_prots
+// Are reused by the next Batch if referenceKey is the same
+string referenceKey;
+
+
+
+struct Batch; 
+struct BlastAlignment;
+
+
+
+struct HmmAlignment 
+// Query: AMR HMM
+{
+  string sseqid; 
+  double score1 {NaN}; 
+  double score2 {NaN}; 
+    // May be different from max(Domain::score)
+  const Fam* fam {nullptr};
+    // Query
+    // !nullptr
+//ali_from, ali_to ??
+  unique_ptr<const BlastAlignment> blastAl;
+    // (bool)get()
+  
+  
+  HmmAlignment (const string &line,
+                const Batch &batch);
+    // Update: batch.domains
+  void saveText (ostream &os) const 
+    { os << sseqid << ' ' << score1 << ' ' << score2 << ' ' << (fam ? fam->hmm : noString); }
+      
+      
+  bool good () const
+    { QC_ASSERT (fam);
+      QC_ASSERT (! fam->hmm. empty ());
+    	return    score1 >= fam->tc1
+             && score2 >= fam->tc2; 
+    }
+private:
+  bool betterEq (const HmmAlignment &other,
+                 unsigned char criterion) const
+    // Reflexive
+    // Must: transitive
+    // For one sseqid: one HmmAlignment is better than all others
+    { ASSERT (good ());
+      ASSERT (other. good ());
+      if (sseqid != other. sseqid)
+        return false;
+      switch (criterion)
+      {
+        case 0: return fam->descendantOf (other. fam); 
+        case 1: 
+          {
+            LESS_PART (other, *this, score1);
+          //return score2 >= other. score2;  // GP-16770
+            LESS_PART (other, *this, fam->tc1);
+            if (! equidistant)
+              LESS_PART (*this, other, fam->id);  // Tie resolution
+            return true;
+          }
+        default: ERROR;
+      }
+      throw logic_error ("Never call");
+    }
+public:
+  bool better (const HmmAlignment &other,
+               unsigned char criterion) const
+    { return             betterEq (other, criterion) 
+             && ! other. betterEq (*this, criterion); }
+  bool better (const BlastAlignment &other) const;
+
+
+  typedef  pair<string/*sseqid*/,string/*FAM.id*/>  Pair;
+  struct PairHash
+  {
+    size_t operator() (const Pair &p) const
+      { return hash<string> () (p. first) * 31 + hash<string> () (p. second); }
+  };
+  
+  
+  struct Domain  
+  {
+    double score {0};
+    size_t hmmLen {0};
+    size_t hmmStart {0}; 
+    size_t hmmStop {0};
+    size_t seqLen {0}; 
+    size_t seqStart {0};
+    size_t seqStop {0}; 
+    
+
+    Domain (const string &line,
+            Batch &batch);
+      // Input: line: hmmsearch -domtable line
+    Domain () = default;
+  };
+
+  // Memory
+  static BlockPool pool;
+  static void* operator new (size_t size)
+    { return pool. allocate (size); }
+  static void operator delete (void* p)
+    { pool. deallocate (p); }
+};
+
+
+BlockPool HmmAlignment::pool (sizeof (HmmAlignment));
+
+
+
+struct Susceptible final : Root
+{
+	// !empty()
+	string genesymbol;
+	double cutoff;
+	  // 0 <=> broken gene confers resistance
+	string classS;
+	string subclass;
+	string name;
+	
+	
+	Susceptible (const string &genesymbol_arg,
+	             double cutoff_arg,
+  			 			 const string &class_arg,
+  				 		 const string &subclass_arg,
+  						 const string &name_arg)
+    : genesymbol (genesymbol_arg)
+    , cutoff (cutoff_arg / 100.0)
+    , classS (class_arg)
+    , subclass (subclass_arg)
+    , name (name_arg)
+    { 
+      QC_ASSERT (cutoff >= 0.0);
+      QC_ASSERT (cutoff < 1.0);
+    	QC_ASSERT (! name. empty ());
+      QC_ASSERT (! contains (name, '\t'));
+      replace (name, '_', ' ');
+      QC_ASSERT (! contains (name, "  "));
+    }
+  Susceptible () = default;
+  Susceptible& operator= (Susceptible&& other) = default;
+  void saveText (ostream &os) const final
+    { os         << genesymbol 
+         << '\t' << cutoff 
+         << '\t' << classS
+         << '\t' << subclass
+         << '\t' << name
+         << endl;
+    }
+};
+
+
+unordered_map <string/*accession*/, Susceptible>  accession2susceptible;
+StringVector alien_prots;  // of accessions
+
+
+
+struct RefProt
+// Reference protein metadata, shared by BlastAlignment's
+{
+  const string* accession {nullptr};
+    // In refAccessions
+  AmrMutation mutation;
+  size_t part {1};    
+  size_t parts {1};  
+  // Table FAM
+  string famId;  
+  string gene;   
+  string resistance;
+  uchar reportable {0};
+  string classS;
+  string subclass;
+  string product;  
+
+
+  static const RefProt& get (const string &qseqid);
+    // Input: qseqid: AMRProt FASTA identifier
+  static const RefProt& get (const Fam &fam,
+                             const string* accession);
+    // Input: accession: nullptr or RefProt::accession
+private:
+  static const string* intern (const string &accession);
+};
+
+
+unordered_set<string> refAccessions;
+  // Equal accessions have the same address
+unordered_map<string/*key*/,RefProt> key2refProt;
+  // key: AMRProt FASTA identifier, or '\t' + Fam::id + '\t' + accession
+mutex key2refProtMtx;
+  // For refAccessions and key2refProt
+
+
+
+const string* RefProt::intern (const string &accession)
+{
+  return & * refAccessions. insert (accession). first;
+}
+
+
+
+const RefProt& RefProt::get (const string &qseqid)
+{
+  const lock_guard<mutex> lg (key2refProtMtx);
+  if (const RefProt* ref = findPtr (key2refProt, qseqid))
+    return *ref;
+    
+  RefProt ref;
+  try
+  {
+    string_view rest (qseqid);
+    ref. product                     =                          rfindSplit (rest, '|'); 
+    ref. classS                      =                          rfindSplit (rest, '|'); 
+    ref. subclass                    =                          rfindSplit (rest, '|'); 
+    ref. reportable                  = (uchar) view2int<int>   (rfindSplit (rest, '|')); 
+    ref. resistance                  =                          rfindSplit (rest, '|'); 
+    ref. gene                        =                          rfindSplit (rest, '|');  // Reportable_vw.class
+    ref. famId                       =                          rfindSplit (rest, '|');  // Reportable_vw.fam
+    ref. parts                       = (size_t) view2int<int>  (rfindSplit (rest, '|'));
+    ref. part                        = (size_t) view2int<int>  (rfindSplit (rest, '|'));
+    string accession                 (                                      rest);  // rfindSplit (rest, '|');
+    if (contains (accession, ':'))  
+    {
+      QC_ASSERT (ref. resistance == "mutation");
+      string_view acc (accession);
+      const string geneMutation (               rfindSplit (acc, ':'));
+      const size_t pos          = view2int<size_t> (rfindSplit (acc, ':'));
+      accession. erase (acc. size ());
+      ref. mutation = std::move (AmrMutation (pos, geneMutation));
+      QC_ASSERT (! ref. mutation. empty ());
+      ref. mutation. qc ();
+    }
+    QC_ASSERT (! accession. empty ());
+    ref. accession = intern (accession);
+  }
+  catch (const exception &e)
+  {
+  	throw runtime_error (string ("Bad AMRFinder database\n") + e. what () + "\n" + qseqid);
+  }
+  replace (ref. product,  '_', ' ');
+  replace (ref. classS,   '_', ' ');
+  replace (ref. subclass, '_', ' ');
+  
+  return key2refProt [qseqid] = std::move (ref);
+}
+
+
+
+const RefProt& RefProt::get (const Fam &fam,
+                             const string* accession)
+{
+  const string key ('\t' + fam. id + '\t' + (accession ? *accession : noString));
+  const lock_guard<mutex> lg (key2refProtMtx);
+  if (const RefProt* ref = findPtr (key2refProt, key))
+    return *ref;
+
+  RefProt ref;
+  ref. accession = accession ? accession : intern (noString);
+  ref. famId     = fam. id;
+  ref. gene      = fam. id;
+  ref. product   = fam. familyName;
+  
+  return key2refProt [key] = std::move (ref);
+}
+
+
+
+void clearReference ()
+{
+  referenceKey. clear ();
+  for (const auto& it : famId2fam)
+    delete it. second;
+  famId2fam. clear ();
+  hmm2fam. clear ();
+  accession2mutations. clear ();
+  accession2susceptible. clear ();
+  alien_prots. clear ();
+  key2refProt. clear ();
+  refAccessions. clear ();
+}
+
+
+
+struct BlastAlignment final : Alignment
+// BLASTP or BLASTX
+{
+  // Target  
+  bool partialDna {false};
+  
+  // Reference protein
+  const bool fromHmm;
+  const RefProt& ref;
+  const string& refAccession {* ref. accession}; 
+    // empty() <=> HMM method
+    // Interned
+  const size_t part {ref. part};    
+    // >= 1
+    // <= parts
+  const size_t parts {ref. parts};  
+    // >= 1
+    // > 1 <=> fusion protein
+  VectorPtr<BlastAlignment> fusions;
+  bool fusionRedundant {false};
+  // Table FAM
+  const string& famId {ref. famId};  
+  const string& gene {ref. gene};   
+    // FAM.class  
+  const string& resistance {ref. resistance};
+  const uchar reportable {ref. reportable};
+  const string& classS {ref. classS};
+  const string& subclass {ref. subclass};
+
+  const Fam* brFam {nullptr};
+  // Valid if !fromHmm and inFam()
+  BlastRule completeBR;  
+  BlastRule partialBR;   
+  
+  const string& product {ref. product};  
+  Vector<Locus> cdss;
+  static constexpr size_t mismatchTail_aa = 10;  // PAR
+  static constexpr size_t cdsDist_max = 60 * 3;  // PAR, PD-4169
+  
+  const Susceptible* susceptible {nullptr};
+    // In accession2susceptible
+    // Only for the right organism
+  
+  const HmmAlignment* hmmAl {nullptr};
+
+
+  BlastAlignment (const string &line,
+                  bool sProt_arg)
+    : Alignment (line, true, sProt_arg)
+    , fromHmm (false)
+    , ref (RefProt::get (qseqid))
+    {
+    	try 
+    	{
+		    trimTailAt (qseqid, "|");
+		    if (! ref. mutation. empty ())
+		    {
+		      ASSERT (refMutation. empty ());
+		      refMutation = ref. mutation;
+		    }
+        if (isSusceptibleProt ())
+		      susceptible = findPtr (accession2susceptible, refAccession);
+  	    if (isMutationProt ())
+  		    if (const Vector<AmrMutation>* refMutations = findPtr (accession2mutations, refAccession))
+  		    {
+  		    	if (verbose ())
+  		        cout << "AmrMutation protein found: " << refAccession << endl << line << endl;
+    	      setSeqChanges (*refMutations, 0);
+    	      if (verbose ())
+    	        cout << endl;
+  		    }
+  		  if (sProt)
+  		    finish ();
+		  }
+		  catch (const exception &e)
+		  {
+		  	throw runtime_error (line + "\n" + e. what ());;
+		  }
+    }
+  BlastAlignment (const HmmAlignment& hmmAl_arg,
+                  const BlastAlignment* best)
+    : fromHmm    (true)
+    , ref        (RefProt::get (* hmmAl_arg. fam, best ? best->ref. accession : nullptr))
+    , hmmAl      (& hmmAl_arg)  
+    { ASSERT (hmmAl_arg. good ());
+      sProt = true;
+      if (best)
+        Hsp::operator= (*best);
+      sseqid = hmmAl_arg. sseqid;
+      finishHsp (false, false);
+      ASSERT (sProt);
+      ASSERT (! allele ());
+    }
+  void finish ()
+    {
+      ASSERT (! fromHmm);      
+      // BlastRule
+	    // PD-2310
+      if (inFam ())
+      {
+		    // PD-4856
+		    ASSERT (! brFam);
+		    // brFam
+        EXEC_ASSERT (brFam = getFam ()); 
+        while (brFam)
+        {
+          if (partial ())
+          {
+            if (passBlastRule (brFam->partialBR))
+          	  break;
+          }
+          else
+            if (passBlastRule (brFam->completeBR))
+          	  break;
+          brFam = brFam->parent;
+        }
+		  }
+		  else
+		  {
+	      completeBR = defaultCompleteBR;
+	      partialBR  = defaultPartialBR;
+	    }
+	    //
+	    partialDna = false;
+	    constexpr size_t mismatchTailDna = 10;  // PAR
+	    if (! sProt && sAbsCoverage () >= 30)  // PAR, PD-671
+	    {
+	           if (qInt. start > 0   && sTail (true)  <= mismatchTailDna)  partialDna = true;
+	      else if (qInt. stop < qlen && sTail (false) <= mismatchTailDna)  partialDna = true;
+	    }
+      //
+	    if (! sProt)
+	      cdss. emplace_back (0, sseqid, sInt. start, sInt. stop, sInt. strand == 1, partialDna, 0, noString, noString);
+    }
+  void qc () const override
+    {
+      if (! qc_on)
+        return;
+      Alignment::qc ();
+      if (empty ())
+        return;
+      QC_ASSERT (qProt);
+	    QC_ASSERT (! famId. empty ());
+	    QC_ASSERT (! gene. empty ());
+	    QC_ASSERT (part >= 1);
+	    QC_ASSERT (part <= parts);
+	  //QC_IMPLY (part > 1, ! fusions. empty () || fusionRedundant);
+	    QC_IMPLY (! fusions. empty (), parts >= 2);
+	    QC_IMPLY (isMutationProt (), ! isSusceptibleProt ());
+	    QC_IMPLY (susceptible, isSusceptibleProt ());
+	    QC_IMPLY (isStrongSusceptibleProt (), isSusceptibleProt ());
+	    QC_IMPLY (isSusceptibleProt (), fusions. empty () && ! fusionRedundant);
+	    QC_IMPLY (isMutationProt (), fusions. empty () && ! fusionRedundant);
+	    QC_IMPLY (! isMutationProt () && ! seqChanges. empty () && ! seqChanges. front (). empty (), isStrongSusceptibleProt ());
+	    QC_IMPLY (hasDeclarativeFrameshift (), isMutationProt ());
+	    QC_IMPLY (! fusions. empty (), fusions. size () >= 2);
+	    QC_IMPLY (! fusions. empty (), fusions. front () == this);
+	    QC_IMPLY (fusionRedundant, fusions. empty ());
+	    QC_ASSERT (! product. empty ());
+	    QC_IMPLY (! fromHmm, ! refAccession. empty ());
+	    QC_ASSERT (refAccession. empty () == sseq. empty ());
+	    QC_ASSERT (! refAccession. empty () == (bool) qlen);
+	    QC_ASSERT (! refAccession. empty () == (bool) nident);
+	    QC_IMPLY (refAccession. empty () && inFam (), ! getFam () -> hmm. empty ());
+	    QC_IMPLY (sProt, ! partialDna);
+	    QC_IMPLY (! refMutation. empty (), isMutationProt ());
+	    if (! sProt)
+    	  for (const Locus& cds : cdss)
+    	    QC_ASSERT (cds. contig == sseqid);
+	    QC_IMPLY (! seqChanges. empty (), isMutationProt () || isStrongSusceptibleProt ());
+    }
+  void report (TsvOut &td,
+               const string &targetName,
+               bool mutationAll) const 
+    { // PD-736, PD-774, PD-780, PD-799
+      const string proteinName (susceptible
+                                  ? susceptible->name
+                                  : isMutationProt () 
+                                    ? product 
+                                    : refProtExactlyMatched (true) || parts >= 2 || refAccession. empty ()   // PD-3187, PD-3192
+                                      ? product 
+                                      : nvl (checkPtr (getMatchFam ()) -> familyName, na)
+                               );      
+      ASSERT (! contains (proteinName, '\t'));
+      Vector<Locus> cdss_ (cdss);
+      if (cdss_. empty ())
+        cdss_ << Locus ();
+      Vector<SeqChange> seqChanges_ (seqChanges);
+      if (seqChanges_. empty ())
+        seqChanges_ << SeqChange ();
+      for (const Locus& cds : cdss_)
+      {
+        if (sProt)
+        {
+          if (targetProt)
+            { ASSERT (sseqid == targetName); }
+          else
+            if (cds. contig != targetName)
+              continue;
+        }
+        else
+          { ASSERT (sseqid == targetName); }
+	      for (const SeqChange& seqChange : seqChanges_)
+	      {
+          const string method (empty () ? na : getMethod (cds));
+          VectorPtr<AmrMutation> mutations (seqChange. mutations);
+          if (mutations. empty ())
+            mutations << nullptr;
+          for (const AmrMutation* mut : mutations)
+          {
+            QC_IMPLY (! verbose () && isMutationProt (), ! seqChange. empty () || mut);
+  	        const bool isMutation = ! seqChange. empty () && mut && ! seqChange. replacement;
+  	        if (mutationAll)
+  	        {
+  	          if (! isMutationProt ())
+  	            continue;
+  	        }
+  	        else if (isMutationProt () && ! isMutation)
+  	          continue;
+      	    if (! input_name. empty ())
+      	      td << input_name;
+            td << (sProt ? nvl (sseqid, na) : na);  // PD-2534
+  	        if (cdsExist)
+  	          td << (empty () ? na : (cds. contig. empty () ? nvl (sseqid, na)  : cds. contig))
+  	             << (empty () ? 0  : (cds. contig. empty () ? sInt. start : cds. start) + 1)
+  	             << (empty () ? 0  : (cds. contig. empty () ? sInt. stop  : cds. stop))
+  	             << (empty () ? na : string (1, cds. contig. empty () ? strand2char (sInt. strand) : (cds. strand ? '+' : '-')));
+  	        td << (isMutationProt ()
+  			             ? mut 
+  			               ? seqChange. empty ()
+                         ? mut->wildtype ()
+  			                 : mut->geneMutation
+  			               : gene + "_" + seqChange. getMutationStr ()
+ 			               : seqChange. empty ()
+                       ? fusion2geneSymbols ()
+                       : gene + disruption_delim + seqChange. getMutationStr ()  // isStrongSusceptibleProt()
+                  )
+  	           << (isMutationProt ()
+  	                 ? mut 
+                       ? seqChange. empty ()
+                         ? proteinName + " [WILDTYPE]"
+                         : mut->name
+                       : proteinName + " [UNKNOWN]"
+  	                 : proteinName 
+  	              )
+  	           << (isMutationProt () || fusion2core () ? "core" : "plus");  // PD-2825
+            // PD-1856
+  	        if (isMutationProt ())
+  	          td << "AMR"
+  	             << "POINT"
+  	             << (mut ? nvl (mut->classS,   na) : na)
+  	             << (mut ? nvl (mut->subclass, na) : na);
+  	        else
+  	          td << nvl (fusion2type (), na)  
+    	           << (isStrongSusceptibleProt () ? "POINT_DISRUPT" : nvl (fusion2subtype (), na))
+    	           << nvl (fusion2class (), na)
+    	           << nvl (fusion2subclass (), na);
+  	        td << method
+  	           << (sProt ? slen : (sAbsCoverage () / 3));  // Approximate for disrupted genes
+  	        if (refAccession. empty ())
+  	          td << na 
+  	             << na
+  	             << na
+  	             << na
+  	             << na
+  	             << na;
+  	        else
+  	          td << qlen
+  	             << qRelCoverage () * 100.0  
+  	             << relIdentity () * 100.0  // refIdentity
+  	             << sseq. size ()
+  	             << refAccession
+  	             << product 
+  	             ;
+  	        // PD-775
+  	        if (isMutationProt ())
+  	          td << na
+  	             << na;
+  	        else 
+  	        {
+  	          if (const HmmAlignment* hmmAl_ = fusion2hmmAl ())
+    	          td << hmmAl_->fam->hmm
+    	             << hmmAl_->fam->familyName;
+    	        else
+    	        {
+    	          td << na
+    	             << na;
+    	          ASSERT (method != "HMM");
+    	        }
+    	      }
+  	        if (cdsExist)
+  	        {
+  	        	IMPLY (cds. crossOrigin, useCrossOrigin);
+  	        	if (useCrossOrigin)
+  	        	{
+  		          if (cds. crossOrigin) 
+  		            td << cds. contigLen;
+  		          else 
+  		            td << na;        	
+  		        }
+  	        }
+  	        if (print_node)
+  	        {
+  	          if (! print_node_raw && allele () && ! refProtExactlyMatched (true))
+  	            td << gene;
+  	          else
+  	            td << fusion2famIds ();
+  	        }
+  	        IMPLY (isMutationProt () && isMutation /*! seqChange. empty () && mut && ! seqChange. replacement*/, hasMutation ());
+  	        td. newLn ();
+  	      }
+	      }
+	    }
+    }
+    
+
+  // Sequence mutations confer resistsance
+  bool isMutationProt () const
+    { return resistance == "mutation"; }
+  bool isSusceptibleProt () const
+    { return resistance == "susceptible"; }  
+  bool isStrongSusceptibleProt () const
+    { return    susceptible 
+             && ! susceptible->cutoff; 
+    }  
+  //
+  bool inFam () const
+    { return    ! isMutationProt () 
+             && ! isSusceptibleProt (); 
+    } 
+#if 0
+  bool notInFam () const
+    { return ! inFam (); }
+#endif
+  Set<string> getMutationSymbols () const
+    { Set<string> mutationSymbols;
+      for (const SeqChange& seqChange : seqChanges)
+        if (! seqChange. empty ())
+          for (const AmrMutation* mutation : seqChange. mutations)
+            mutationSymbols << mutation->geneMutation;
+      return mutationSymbols;
+    }        
+  bool allele () const
+    { return famId != gene && parts == 1; }
+  size_t refEffectiveLen () const
+    { return partialDna ? qInt. len () : qlen; }
+  bool partial () const
+    // Requires: good()
+    { return qRelCoverage () < defaultCompleteBR. ref_coverage - frac_delta; }  
+  bool getTargetStrand (const Locus &cds) const
+    { return sProt
+               ? cds. empty ()
+                 ? true
+                 : cds. strand
+               : (sInt. strand == 1);
+    }
+  size_t missedDnaStart (const Locus &cds) const
+    { return 3 * (getTargetStrand (cds)
+                    ? qInt. start
+                    : qlen - qInt. stop
+                 );
+    }
+  size_t missedDnaStop (const Locus &cds) const
+    { return 3 * (getTargetStrand (cds)
+                    ? qlen - qInt. stop
+                    : qInt. start
+                 );
+    }
+  bool truncated (const Locus &cds) const
+    { return    (missedDnaStart (cds) > 0 && (sProt ? (cds. empty () ? false : cds. atContigStart ()) : sInt. start       <= Locus::end_delta))
+             || (missedDnaStop  (cds) > 0 && (sProt ? (cds. empty () ? false : cds. atContigStop  ()) : slen - sInt. stop <= Locus::end_delta));
+    }
+  bool truncatedCds () const
+    { for (const Locus& cds : cdss)
+        if (truncated (cds))
+          return true;
+      return false;
+    }
+  bool refProtExactlyMatched (bool targetComplete) const
+    { return    qProt
+             && qlen   
+             && nident == qlen 
+             && nident == sseq. size ()
+             && c_complete != efalse
+             && (! sProt || ! targetComplete || qlen + (c_complete == etrue ? 1 : 0) == slen)
+             && disrs. empty ();
+	  }
+  bool alleleMatch () const
+    { return refProtExactlyMatched (true) && allele (); }
+  bool alleleReportable () const  // PD-3583
+    { return alleleMatch () && reportable >= 2; }
+  uchar getReportable () const
+    { if (const Fam* f = getMatchFam ())
+        return f->reportable;
+      return 0;
+    }
+  uchar fusion2reportable () const
+    { ASSERT (! isMutationProt ());
+      if (susceptible)
+        return 2;
+      if (fusions. empty ())
+        return getReportable ();
+      uchar reportable_max = 0;
+      for (const BlastAlignment* fusion : fusions)
+        maximize (reportable_max, fusion->getReportable ());
+      return reportable_max;
+    }
+  bool fusionOverrides (const BlastAlignment &other) const
+    { ASSERT (sProt == other. sProt);
+      return    parts > 1
+  	         && other. parts == 1
+  	         && other. insideEq (*this)
+  	         && (   sInt. start + Cds::peptideSize_min * a2s <= other. sInt. start 
+                 || sInt. stop                               >= other. sInt. stop + Cds::peptideSize_min * a2s
+                );
+    }
+private:
+  string getGeneSymbol () const
+    { return susceptible
+               ? susceptible->genesymbol
+               : alleleMatch () 
+                 ? famId 
+                 : nvl (checkPtr (getMatchFam ()) -> genesymbol, na);
+    }
+public:
+  string fusion2geneSymbols () const
+    { ASSERT (! isMutationProt ());
+      if (fusions. empty ())
+        return getGeneSymbol ();
+      string s;
+      for (const BlastAlignment* fusion : fusions)
+        add (s, "/" /*fusion_infix*/, fusion->getGeneSymbol ());  // PD-5155 ??
+      return s;
+    }
+  bool sameGeneSymbols (const BlastAlignment &other) const
+    // Return: fusion2geneSymbols() == other.fusion2geneSymbols()
+    { ASSERT (! isMutationProt ());
+      ASSERT (! other. isMutationProt ());
+      if (fusions. empty () && other. fusions. empty ())
+        return getGeneSymbol () == other. getGeneSymbol ();
+      return fusion2geneSymbols () == other. fusion2geneSymbols ();
+    }
+  string fusion2famIds () const
+    { if (isMutationProt () || fusions. empty ())
+        return famId;
+      string s;
+      for (const BlastAlignment* fusion : fusions)
+        add (s, fusion_infix, fusion->famId);
+      return s;
+    }
+private:
+  bool isCore () const 
+    { return fusion2reportable () >= 2 || alleleReportable (); }
+public:
+  bool fusion2core () const
+    { ASSERT (! isMutationProt ());
+      if (fusions. empty ())
+        return isCore ();
+      for (const BlastAlignment* fusion : fusions)
+        if (fusion->isCore ())
+          return true;
+      return false;
+    }
+private:
+  string getType () const
+    { return susceptible ? "AMR" : checkPtr (getMatchFam ()) -> type; }
+public:
+  string fusion2type () const
+    { ASSERT (! isMutationProt ());
+      if (fusions. empty ())
+        return getType ();
+      StringVector vec;
+      for (const BlastAlignment* fusion : fusions)
+        vec << fusion->getType ();
+      vec. sort ();
+      vec. uniq ();
+      return vec. toString ("/");
+    }    
+private:
+  string getSubtype () const
+    { return susceptible ? "AMR" : checkPtr (getMatchFam ()) -> subtype; }
+public:
+  string fusion2subtype () const
+    { ASSERT (! isMutationProt ());
+      if (fusions. empty ())
+        return getSubtype ();
+      StringVector vec;
+      for (const BlastAlignment* fusion : fusions)
+        vec << fusion->getSubtype ();
+      vec. sort ();
+      vec. uniq ();
+      return vec. toString ("/");
+    }    
+private:
+	string getClass () const
+	  { if (alleleMatch () && ! subclass. empty ())  // class may be empty()
+	      return classS;
+	    return susceptible ? susceptible->classS : checkPtr (getMatchFam ()) -> classS;
+	  }
+public:
+  string fusion2class () const
+    { ASSERT (! isMutationProt ());
+      if (fusions. empty ())
+        return getClass ();
+      StringVector vec;
+      for (const BlastAlignment* fusion : fusions)
+        vec << std::move (StringVector (fusion->getClass (), '/', true));
+      vec. sort ();
+      vec. uniq ();
+      return vec. toString ("/");
+    }   
+private: 
+	string getSubclass () const
+	  { if (alleleMatch () && ! subclass. empty ())
+	      return subclass;
+	    return susceptible ? susceptible->subclass : checkPtr (getMatchFam ()) -> subclass;
+	  }
+public:
+  string fusion2subclass () const
+    { ASSERT (! isMutationProt ());
+      if (fusions. empty ())
+        return getSubclass ();
+      StringVector vec;
+      for (const BlastAlignment* fusion : fusions)
+        vec << std::move (StringVector (fusion->getSubclass (), '/', true));
+      vec. sort ();
+      vec. uniq ();
+      return vec. toString ("/");
+    }    
+  const HmmAlignment* fusion2hmmAl () const
+    { if (fusions. empty ())
+        return hmmAl;
+      for (const BlastAlignment* fusion : fusions)
+        if (fusion->hmmAl)
+          return fusion->hmmAl;
+      return nullptr;
+    }    
+	string getMethod (const Locus &cds) const
+	  { //IMPLY (refExactlyMatched () && ! mutation_all. get (), ! isMutationProt ())
+	    string method (fromHmm
+	                     ? "HMM"
+	                     : isMutationProt () || isStrongSusceptibleProt ()
+    	                   ? "POINT"
+    	                   : refProtExactlyMatched (true) 
+            	             ? alleleMatch () 
+            	               ? "ALLELE"
+            	               : "EXACT"  // PD-776
+        	                 : partial ()
+          	                 ? truncated (cds)
+          	                   ? partialContigEnd_Name  // PD-2267
+          	                   : partial_Name
+        	                   : "BLAST"
+        	           );
+      // PD-2088, PD-2320
+      bool suffix = true;
+	    if (   (   method == "BLAST" 
+    	        || method == partial_Name
+    	        || method == partialContigEnd_Name
+    	       ) 
+	      //&& ! sProt  // Redundant
+	       )
+	    {
+	      if (sInternalStop)
+	      {
+	        method = internalStop_Name;	
+  	      suffix = false;
+	      }
+	    #if 0
+	      else if (findDisruption (Disruption::eFrameshift))
+	      {
+	        method = frameshift_Name;
+	        suffix = false;
+	      }
+	      else if (hasLongDisruption (10))  // PAR 
+	      {
+	        method = "DISRUPTED";
+	        suffix = false;
+	      }
+	    #endif
+	    }
+	    if (suffix && method != "HMM")
+	      method += (sProt ? "P" : "X");	  
+	    return method;
+	  }
+	  // PD-736
+	bool passBlastRule (const BlastRule &br) const
+	  { ASSERT (! br. empty ());
+	    return    relIdentity ()  >= br. ident        - frac_delta
+  	         && qRelCoverage () >= br. ref_coverage - frac_delta;
+	  }	
+	bool partialPseudo () const
+	  { return    partial () 
+             && ! cdss. empty ()
+             && ! truncatedCds ();
+	  }
+#if 0
+	bool pseudo () const
+	  { return    sInternalStop
+	           || partialPseudo ();
+	  }
+#endif
+	StringVector getContigs () const
+	  { ASSERT (! cdss. empty ());
+	    StringVector contigs;  contigs. reserve (cdss. size ());
+	    for (const Locus& locus : cdss)
+	      contigs << locus. contig;
+	    contigs. sort ();
+	    contigs. uniq ();
+	    return contigs;
+	  }
+  bool good () const
+    { ASSERT (! fromHmm);
+      if (refAccession. empty ())
+        return true;
+    //if (! refMutation. empty ())   // PD-4981: drop
+      //return true;      
+    #if 0
+      if (refAccession == "WP_104009840.1" && sseqid == "blaPDC-114_added")
+      {
+      //PRINT (reportPseudo);
+      //PRINT (pseudo ());
+        PRINT (isMutationProt ());
+        PRINT (seqChanges. empty ());
+        PRINT (isSusceptibleProt ());
+        PRINT (susceptible);
+        PRINT (disrs. empty ());
+        PRINT (partial ());
+        PRINT (parts);
+        PRINT (truncatedCds ());
+        PRINT (brFam);
+        PRINT (inFam ());
+      //PRINT (passBlastRule (partialBR));
+      //PRINT (passBlastRule (completeBR));
+        cout << endl;
+        saveText (cout);        
+      }
+    #endif
+    #if 0
+      if (! reportPseudo && pseudo ())
+        return false;
+    #endif
+      if (isMutationProt () && seqChanges. empty ())  // PD-4981
+        return false;
+      if (isSusceptibleProt () && ! susceptible)  // Alien organism
+        return false;
+		  if (susceptible)
+		  {
+        if (susceptible->cutoff)
+        {
+          if (relIdentity () > susceptible->cutoff + frac_delta) 
+            return false;
+        }
+        else if (disrs. empty ())
+          return false;
+	    }
+  	  // PD-1032
+	    if (   partial ()
+	        && (   parts > 1 
+    	        || (! truncatedCds () && qInt. len () <= 35)  // PAR  // PD-3287
+    	       )
+    	   )
+  	    return false;
+  	  if (brFam)
+  	    return true;  	  
+  	  if (inFam ())  // !brFam
+  	    return false;
+	    if (partial ())
+        return passBlastRule (partialBR);
+      return passBlastRule (completeBR);
+    }
+private:
+  bool insideEq (const BlastAlignment &other) const
+    { ASSERT (sProt  == other. sProt);
+      ASSERT (sseqid == other. sseqid);
+    	if (sInt. strand != other. sInt. strand)
+    	  return false;
+    	if (   sInt. start + mismatchTail_aa * a2s >= other. sInt. start 
+          && sInt. stop                          <= other. sInt. stop + mismatchTail_aa * a2s
+         )
+        return true;
+      if (   ! partialPseudo ()
+          || isMutationProt ()
+          || other. isMutationProt ()
+          || ! sameGeneSymbols (other)
+         )
+        return false;
+      // PD-4698
+      // Most probably a repeat protein
+      const size_t pseudoOverlap = mismatchTail_aa * a2s * 2;  // PAR
+      return    (sInt. start < other. sInt. start && sInt. stop                  >= other. sInt. start + pseudoOverlap)
+             || (sInt. stop  > other. sInt. stop  && sInt. start + pseudoOverlap <= other. sInt. stop);
+    }
+  bool matchesCds (const BlastAlignment &other) const
+    { ASSERT (sProt);
+    	ASSERT (! other. sProt);
+    	ASSERT (! cdss. empty ());
+    	for (const Locus& cds : cdss)
+    		if (   cds. contig == other. sseqid
+    			  && cds. strand == (other. sInt. strand == 1)
+    			  && ! cds. crossOrigin
+    			 )
+    		{ size_t protStart = cds. start;
+    			size_t protStop  = cds. stop;
+    			if (cds. strand)
+    			{
+    				ASSERT (protStop > 3);
+    				protStop -= 3;
+    			}
+    			else
+    			  protStart += 3;
+    			ASSERT (protStart < protStop);
+    			const size_t dnaStart  = other. sInt. start;
+    			const size_t dnaStop   = other. sInt. stop;
+    			ASSERT (dnaStart < dnaStop);
+    			const size_t intersectionStart = max (protStart, dnaStart);
+    			const size_t intersectionStop  = min (protStop,  dnaStop);
+    			const size_t unionStart        = min (protStart, dnaStart);
+    			const size_t unionStop         = max (protStop,  dnaStop);
+    			if (   (   intersectionStart < intersectionStop
+    				      && double (intersectionStop - intersectionStart) / double (protStop - protStart) > 0.75  // PAR, PD-2320
+    				     )
+    				  || (intersectionStart - unionStart) + (unionStop - intersectionStop) <= cdsDist_max
+    				  || (   protStart <= dnaStart + mismatchTail_aa * 3 
+    				      && dnaStop   <= protStop + mismatchTail_aa * 3 
+    				      && other. partial ()
+    				     )
+    				  || (   dnaStart <= protStart + mismatchTail_aa * 3 
+    				      && protStop <= dnaStop   + mismatchTail_aa * 3 
+    				      && partial ()
+    				     )
+    				 )
+    				return true;
+    		}
+    	return false;
+    }
+  bool betterEq (const BlastAlignment &other) const
+    // Reflexive
+    // Must: transitive
+    { if (this == & other)
+        return true;
+      // PD-4981
+      if (isMutationProt () != other. isMutationProt ())  
+        return false;
+      if (refMutation. empty () != other. refMutation. empty ())  
+        return false;
+      if (isSusceptibleProt () != other. isSusceptibleProt ())          
+        return false;
+      //
+      if (sProt == other. sProt)  
+      {
+	    	if (sseqid != other. sseqid)
+	        return false;
+	    #if 0
+	      if (sseqid == "WP_063839878.1.last91" && qseqid == "WP_063839878.1")
+	      {
+	        PRINT (other. insideEq (*this));
+        	PRINT (insideEq (other));
+        	PRINT (sProt);
+        	PRINT (inFam ());
+        	PRINT (other. inFam ());
+        	PRINT (fusion2geneSymbols ());
+        	PRINT (other. fusion2geneSymbols ());
+        	PRINT (refAccession);
+        	PRINT (other. refAccession);
+        	//
+        	PRINT (nident);
+        	PRINT (sInt. start);
+        	PRINT (sInt. stop);
+        	PRINT (qInt. start);
+        	PRINT (qInt. stop);
+        	PRINT (hasMutation ());
+        	PRINT (refProtExactlyMatched (false)); 
+  	      PRINT (refEffectiveLen ());
+	        //
+        	PRINT (other. nident);
+        	PRINT (other. sInt. start);
+        	PRINT (other. sInt. stop);
+        	PRINT (other. qInt. start);
+        	PRINT (other. qInt. stop);
+        	PRINT (other. hasMutation ());
+        	PRINT (other. refProtExactlyMatched (false)); 
+  	      PRINT (other. refEffectiveLen ());
+  	      cout << endl;
+	      }
+	    #endif
+        // PD-807, PD-4277
+        if (   ! other. insideEq (*this)
+        	  && !        insideEq (other)
+        	 )
+          if (   ! sProt 
+              || (   inFam () /*! isMutationProt ()*/   // PD-4722
+                  && other. inFam () /*! other. isMutationProt ()*/   // PD-4755
+                  && ! sameGeneSymbols (other)
+                 )
+             )  // PD-4687
+            return false;
+        if (   inFam () /*! isMutationProt ()*/
+            && ! refAccession. empty () 
+            && & refAccession == & other. refAccession  // PD-4013
+           )  
+        {
+  	      LESS_PART (other, *this, nident);
+  	      LESS_PART (*this, other, sInt. start);
+  	      LESS_PART (other, *this, sInt. stop);
+  	      LESS_PART (*this, other, qInt. start);
+  	      LESS_PART (other, *this, qInt. stop);
+        }
+        else
+        {
+  	      LESS_PART (other, *this, /*notInFam ()*/ hasMutation ());
+  	      // PD-5427
+  	      if (fusionOverrides (other))
+  	        return true;
+  	      if (other. fusionOverrides (*this))
+  	        return false;
+  	      //
+  	      LESS_PART (other, *this, refProtExactlyMatched (false));  // PD-1261, PD-1678
+  	      LESS_PART (other, *this, nident);
+  	      LESS_PART (*this, other, refEffectiveLen ());  
+  	    }
+	    }
+	    else
+	    { 
+        // PD-1902, PD-2139, PD-2313, PD-2320
+	    	if (sProt && ! matchesCds (other))
+	    	  return false;
+	    	if (! sProt && ! other. matchesCds (*this))
+	    	  return false;
+	      LESS_PART (other, *this, refProtExactlyMatched (false));  
+	    //LESS_PART (other, *this, allele ());  // PD-2352
+	      LESS_PART (other, *this, alleleMatch ());  
+	    //LESS_PART (*this, other, partial ());  // sProt => supposed to be a correct annotation
+	    }
+      if (isMutationProt () && other. isMutationProt ())  
+      {
+			  const Set<string> mutationSymbols      (       getMutationSymbols ());
+			  const Set<string> otherMutationSymbols (other. getMutationSymbols ());
+			  if (mutationSymbols == otherMutationSymbols && sProt != other. sProt)
+			    return sProt;
+			  if (   mutationSymbols. containsAll (otherMutationSymbols)
+			      && ! otherMutationSymbols. containsAll (mutationSymbols)
+			     )
+			    return true;
+			  if (   otherMutationSymbols. containsAll (mutationSymbols)
+			      && ! mutationSymbols. containsAll (otherMutationSymbols)
+			     )
+			    return false;
+			}
+	    LESS_PART (other, *this, sProt);
+      return true;
+    }
+  const Fam* getFam () const
+    { ASSERT (inFam ());
+      const Fam* fam = findPtr (famId2fam, famId);
+      if (! fam)
+        fam = findPtr (famId2fam, gene);
+      if (! fam)
+      	throw runtime_error ("Cannot find hierarchy for: " + famId + " (genesymbol: " + gene + ")");
+      return fam;
+    }
+public:
+  const Fam* getMatchFam () const
+    { ASSERT (inFam ());
+      if (fromHmm)
+        return getFam ();
+      return brFam;
+    }
+  bool better (const BlastAlignment &other) const
+    { return    betterEq (other) 
+    	       && (   ! other. betterEq (*this)
+    	           || (! isMutationProt () /*inFam () --PD-5014*/ && ! equidistant && refAccession < other. refAccession)  // Tie resolution: PD-1245
+    	          );
+    }
+  bool better (const HmmAlignment& other) const
+    { ASSERT (other. good ());
+    	ASSERT (other. blastAl. get ());
+    	ASSERT (inFam ());
+    	if (sProt)
+    	{ if (sseqid != other. sseqid)
+	        return false;
+	    }
+	    else
+	    	if (! other. blastAl->matchesCds (*this))  // ??
+	    		return false;
+      return    refProtExactlyMatched (true) 
+             || (checkPtr (getMatchFam ()) -> descendantOf (other. fam))  
+             ;
+    }
+  size_t getCdsStart () const
+    { if (cdss. empty ())
+        return 0;
+      size_t start = numeric_limits<size_t>::max ();
+      for (const Locus& cds : cdss)
+        minimize (start, cds. start);
+      ASSERT (start != numeric_limits<size_t>::max ());
+      return start;
+    }
+  size_t getCdsStop () const
+    { if (cdss. empty ())
+        return 0;
+      size_t stop = 0;
+      for (const Locus& cds : cdss)
+        maximize (stop, cds. stop);
+      ASSERT (stop);
+      return stop;
+    }
+  void setCdss (const Annot &annot)
+    { ASSERT (sProt);
+    	ASSERT (cdss. empty ());
+    	const Set<Locus> &cdss_ = annot. findLoci (sseqid);
+    	ASSERT (! cdss_. empty ());
+  	  insertAll (cdss, cdss_);
+  	  qc ();
+    }
+  static bool less (const BlastAlignment* a,
+                    const BlastAlignment* b) 
+    { ASSERT (a);
+      ASSERT (b);
+      LESS_PART (*a, *b, sseqid);
+      LESS_PART (*a, *b, sInt. start);
+      LESS_PART (*a, *b, sInt. stop);
+      LESS_PART (*a, *b, getCdsStart ());
+      LESS_PART (*a, *b, getCdsStop ());
+      LESS_PART (*a, *b, refAccession);
+      LESS_PART (*a, *b, part);
+    //LESS_PART (*a, *b, famId);
+    //LESS_PART (*b, *a, relIdentity ());
+      return false;
+    }
+  bool sameMatch (const BlastAlignment* other) const
+    // Cf. less()
+    { ASSERT (other);
+      return    sseqid         == other->sseqid
+             && sInt           == other->sInt
+             && getCdsStart () == other->getCdsStart ()
+             && getCdsStop ()  == other->getCdsStop ()
+             && & refAccession == & other->refAccession;
+    }
+
+  // Memory
+  static BlockPool pool;
+  static void* operator new (size_t size)
+    { return pool. allocate (size); }
+  static void operator delete (void* p)
+    { pool. deallocate (p); }
+};
+
+
+BlockPool BlastAlignment::pool (sizeof (BlastAlignment));
+
+
+
+
+// Pareto-better
+
+template <typename T>
+  void paretoBetter (const VectorPtr<T> &als,
+                     const Vector<size_t> &groups,
+                     const function<bool (const T* a, const T* b)> &better,
+                     VectorPtr<T> &goodAls)
+  // In the order of als: an alignment is skipped if a good alignment is better, otherwise it becomes good and removes the good alignments it is better than
+  // Input: groups: parallel to als; better(a,b) => a and b are in the same group
+  // Output: goodAls: in the order of als
+  // Time: O(sum of squared group sizes)
+  {
+    ASSERT (groups. size () == als. size ());
+    ASSERT (goodAls. empty ());
+    
+    unordered_map<size_t/*group*/,VectorPtr<T>> group2good;
+    FFOR (size_t, i, als. size ())
+    {
+      const T* al = als [i];
+      ASSERT (al);
+      VectorPtr<T>& vec = group2good [groups [i]];
+  	  bool found = false;
+  	  for (const T* goodAl : vec)
+  	    if (better (goodAl, al))
+	      {
+	        found = true;
+	        break;
+	      }
+	    if (found)
+	      continue;	      
+      for (Iter<VectorPtr<T>> goodIter (vec); goodIter. next ();)
+        if (better (al, *goodIter))
+          goodIter. erase ();       
+      vec << al;
+    }
+    
+    if (group2good. size () == 1)
+    {
+      goodAls = std::move (group2good. begin () -> second);
+      return;
+    }
+    unordered_set<const T*> good;
+    for (const auto& it : group2good)
+      for (const T* al : it. second)
+        good. insert (al);
+    for (const T* al : als)
+      if (contains (good, al))
+        goodAls << al;
+  }
+  
+
+
+Vector<size_t> blastParetoGroups (const VectorPtr<BlastAlignment> &als)
+// Return: parallel to als; BlastAlignment::better() is false for alignments of different groups
+// Alignments interact if they are of the same kind (mutation, susceptible) and
+//   proteins: have the same sseqid
+//   DNA: are close on the same contig strand
+//   protein and DNA: a CDS of the protein is close to the DNA alignment
+{
+  constexpr size_t dist_max = BlastAlignment::cdsDist_max;  // >= distance of interacting alignments in insideEq(), matchesCds()
+  
+  struct Node : DisjointCluster {};
+  vector<Node> nodes (als. size ());
+
+  struct Segment 
+  {
+    size_t start;
+    size_t stop;
+    size_t index;
+      // In als
+  };
+  map<tuple<uchar/*kind*/,string/*sseqid*/>,size_t/*index*/> prot2index;
+  map<tuple<uchar/*kind*/,string/*contig*/,bool/*strand*/>,vector<Segment>> contig2segments;
+  FFOR (size_t, i, als. size ())
+  {
+    const BlastAlignment* al = als [i];
+    ASSERT (al);
+    const uchar kind = (uchar) (  (al->isMutationProt ()     ? 4 : 0)
+                                + (al->refMutation. empty () ? 2 : 0)
+                                + (al->isSusceptibleProt ()  ? 1 : 0)
+                               );
+    if (al->sProt)
+    {
+      const auto p = prot2index. insert ({{kind, al->sseqid}, i});
+      if (! p. second)
+        nodes [i]. merge (nodes [p. first->second]);
+      for (const Locus& cds : al->cdss)
+        if (! cds. crossOrigin)
+          contig2segments [{kind, cds. contig, cds. strand}]. push_back (Segment {cds. start, cds. stop, i});
+    }
+    else
+      contig2segments [{kind, al->sseqid, al->sInt. strand == 1}]. push_back (Segment {al->sInt. start, al->sInt. stop, i});
+  }
+  for (auto& it : contig2segments)
+  {
+    vector<Segment>& segments = it. second;
+    sort (segments. begin (), segments. end (), [] (const Segment &a, const Segment &b) { return a. start < b. start; });
+    size_t stop = 0;
+    const Segment* prev = nullptr;
+    for (const Segment& seg : segments)
+    {
+      if (prev && seg. start <= stop + dist_max)
+        nodes [seg. index]. merge (nodes [prev->index]);
+      else
+        stop = 0;
+      maximize (stop, seg. stop);
+      prev = & seg;
+    }
+  }
+  
+  Vector<size_t> groups;  groups. reserve (als. size ());
+  for (Node& node : nodes)
+    groups << (size_t) (static_cast <const Node*> (node. getDisjointCluster ()) - & nodes [0]);
+  return groups;
+}
+
+
+
+
+bool HmmAlignment::better (const BlastAlignment& other) const
+{ 
+  ASSERT (good ());
+  ASSERT (other. good ());
+	ASSERT (other. inFam ());
+	if (! other. sProt)
+	  return false;
+	if (sseqid != other. sseqid)
+    return false;
+  return    fam != other. getMatchFam ()  
+         && fam->descendantOf (other. getMatchFam ());  
+}
+
+
+
+
+// Batch
+
+template <typename T/*:VectorPtr*/>
+  void forEachTarget (map<string,T> &target2als,
+                      size_t threads,
+                      const function<void (const string &target, T &als)> &func)
+  // Invokes: func() for each target in parallel; the first exception in the order of target2als is rethrown
+  // Requires: func() changes only als and the alignments of target
+  {
+    if (threads <= 1 || target2als. size () <= 1 || verbose ())
+    {
+      for (auto& it : target2als)
+        func (it. first, it. second);
+      return;
+    }
+    
+    vector<pair<const string,T>*> items;  items. reserve (target2als. size ());
+    for (auto& it : target2als)
+      items. push_back (& it);
+    vector<exception_ptr> errors (items. size ());
+    atomic<size_t> next {0};
+    const auto worker = [&items, &errors, &next, &func] ()
+      { for (;;)
+        { 
+          const size_t i = next++;
+          if (i >= items. size ())
+            break;
+          try { func (items [i] -> first, items [i] -> second); }
+            catch (...) { errors [i] = current_exception (); }
+        }
+      };
+    {
+      vector<thread> th;
+      FOR_START (size_t, i, 1, min (threads, items. size ()))
+        th. push_back (thread (worker));
+      worker ();
+      for (thread& t : th)
+        t. join ();
+    }
+    for (const exception_ptr& e : errors)
+      if (e)
+        rethrow_exception (e);
+  }
+
+
+
+struct Batch
+{
+  // Reference input
+  uchar reportable_min {0};
+  StringVector suppress_prots;  // of accessions
+
+  // Target input
+  VectorOwn<BlastAlignment> blastAls;
+  mutex blastAlsMtx;
+  VectorOwn<HmmAlignment> hmmAls;
+  bool hmmExist {false};
+  unordered_map<HmmAlignment::Pair, HmmAlignment::Domain, HmmAlignment::PairHash> domains;  // Best domain  
+  
+  // Output
+  //  targetProt => accession is protein 
+  // !targetProt => accession is DNA 
+  map<string/*accession*/,VectorPtr<BlastAlignment>> target2blastAls;
+  map<string/*accession*/,VectorPtr<BlastAlignment>> target2goodBlastAls;
+  //
+  map<string/*protein accession*/,VectorPtr<HmmAlignment>> target2hmmAls;
+  map<string/*protein accession*/,VectorPtr<HmmAlignment>> target2goodHmmAls;
+    
+  
+  Batch (const string &famFName,
+         const string &organism, 
+         const string &mutation_tab,
+         const string &susceptible_tab,
+         const string &suppress_prot_FName,
+         bool non_reportable,
+         bool report_core_only)
+    : reportable_min (non_reportable 
+                        ? 0 
+                        : report_core_only
+                          ? 2
+                          : 1
+                     ) 
+	  {
+	  	const Chronometer_OnePass cop ("Batch", cerr, false, Chronometer::enabled);  
+  
+	    if (famFName. empty ())
+	    	throw runtime_error ("fam (protein family hierarchy) file is missing");
+	    	
+	    const string key (  famFName + '\t' + organism + '\t' + mutation_tab + '\t' + susceptible_tab 
+	                      + '\t' + defaultCompleteBR. str () + '\t' + defaultPartialBR. str () + '\t' + to_string (ident_min_user)
+	                     );
+	    if (key != referenceKey)
+	    {
+	      clearReference ();
+	      readReference (famFName, organism, mutation_tab, susceptible_tab);
+	      referenceKey = key;
+	    }
+	  	  
+  	  if (! suppress_prot_FName. empty ())
+  	  {
+  	    IFStream f (suppress_prot_FName);  	  	    
+	  	  while (! f. eof ())
+	  	  {
+	  	    string accver;
+	  	    f >> accver;
+	  	    if (accver. empty ())
+	  	      break;
+	  	    suppress_prots << accver;
+  	    }
+  	  }  	  
+  	  suppress_prots. sort ();
+	  }
+
+
+private:
+  static void readReference (const string &famFName,
+                             const string &organism, 
+                             const string &mutation_tab,
+                             const string &susceptible_tab)
+  // Output: famId2fam, hmm2fam, accession2mutations, accession2susceptible, alien_prots
+  {
+	    DbSnapshot snapshot;
+	    const bool snapshotP = snapshot. load (getDirName (famFName), true, false);
+	    
+	  	// Tree of Fam
+	  	{
+	  	  Vector<FamRow> famRows;
+	  	  if (snapshotP && snapshot. fams. fresh (famFName))
+	  	    famRows = std::move (snapshot. fams. rows);
+	  	  else
+	  	  {
+  	    	if (verbose ())
+  	    		section ("Reading " + famFName, true);
+  	    	famRows = readFams (famFName);
+  	    }
+  	    VectorPtr<Fam> fams;  fams. reserve (famRows. size ());
+  	    for (const FamRow& row : famRows)
+  	    {
+    	    BlastRule completeBR;
+    	    BlastRule partialBR;
+    	    if (row. complete_ident)
+    	    {
+            completeBR. ident           = row. complete_ident; 
+            completeBR. target_coverage = row. complete_target_coverage; 
+            completeBR. ref_coverage    = row. complete_ref_coverage; 
+            partialBR.  ident           = row. partial_ident; 
+            partialBR.  target_coverage = row. partial_target_coverage; 
+            partialBR.  ref_coverage    = row. partial_ref_coverage; 
+    		    toProb (completeBR. ident);
+    		    toProb (completeBR. target_coverage);
+    		    toProb (completeBR. ref_coverage);
+    		    toProb (partialBR.  ident);
+    		    toProb (partialBR.  target_coverage);
+    		    toProb (partialBR.  ref_coverage);
+      		  completeBR. ref_coverage = defaultCompleteBR. ref_coverage;
+      		  partialBR.  ref_coverage = defaultPartialBR.  ref_coverage;
+      		  if (ident_min_user)
+      		  {
+      		    completeBR. ident = defaultCompleteBR. ident;
+      		    partialBR.  ident = defaultPartialBR.  ident;
+      		  }
+      		}
+      		else
+    		  {
+      		  completeBR = defaultCompleteBR;
+      		  partialBR  = defaultPartialBR;
+    		  }
+    	    const auto fam = new Fam (row. id, row. genesymbol, row. hmm, row. tc1, row. tc2, completeBR, partialBR, row. type, row. subtype, row. classS, row. subclass, row. familyName, row. reportable);
+    	    famId2fam [row. id] = fam;
+    	    if (! fam->hmm. empty ())
+    	      hmm2fam [fam->hmm] = fam;
+    	    fams << fam;
+    	  }
+    	  FFOR (size_t, i, fams. size ())
+    	    if (famRows [i]. parent != no_index)
+    	      var_cast (fams [i]) -> parent = fams [famRows [i]. parent];
+	  	}
+	  	
+	  	if (qc_on)
+	  	{
+	  	  size_t roots = 0;
+	  	  for (const auto& it : famId2fam)
+	  	    if (! it. second->parent)
+	  	      roots++;
+	  	  QC_ASSERT (roots == 1);
+	  	}
+	  	
+	    if (! organism. empty ())
+	    {
+	      {
+	        if (mutation_tab. empty ())
+	          throw runtime_error ("mutation_tab is empty");
+	        Vector<MutationRow> rows;
+	        if (snapshotP && snapshot. mutations. fresh (mutation_tab))
+	          rows = std::move (snapshot. mutations. rows);
+	        else
+	        {
+    	    	if (verbose ())
+    	    		cout << "Reading " << mutation_tab << endl;
+    	    	rows = readMutations (mutation_tab, true);
+    	    }
+  	  	  for (MutationRow& row : rows)
+  	  	    if (row. organism == organism)
+  	  	  		accession2mutations [row. accession]. emplace_back (row. pos, row. geneMutation_std, row. geneMutation_report, row. classS, row. subclass, row. name);
+  	  	  	else
+  	  	  	  alien_prots << std::move (row. accession);
+  	  	  for (auto& it : accession2mutations)
+  	  	  {
+     	  	  it. second. sort ();
+  	  	    if (! it. second. isUniq ())
+  	  	  	  throw runtime_error ("Duplicate mutations for " + it. first);
+  	  	  	sortRefMutations (it. second);
+  	  	  }
+  	  	}
+  	  	if (! susceptible_tab. empty ())
+	      {
+	        Vector<SusceptibleRow> rows;
+	        if (snapshotP && snapshot. susceptibles. fresh (susceptible_tab))
+	          rows = std::move (snapshot. susceptibles. rows);
+	        else
+	        {
+    	    	if (verbose ())
+    	    		cout << "Reading " << susceptible_tab << endl;
+    	    	rows = readSusceptibles (susceptible_tab);
+    	    }
+  	  	  for (SusceptibleRow& row : rows)
+  	  	  	if (row. organism == organism)
+  	  	  	{
+  	  	  	  if (contains (accession2susceptible, row. accession))
+  	  	  	    throw runtime_error ("Duplicate protein accession " + row. accession + " in " + susceptible_tab);
+  	  	      accession2susceptible [row. accession] = std::move (Susceptible (row. genesymbol, row. cutoff, row. classS, row. subclass, row. name));
+  	  	    }
+  	  	  	else
+  	  	  	  alien_prots << std::move (row. accession);
+  	  	  if (verbose ())
+  	  	    PRINT (accession2susceptible. size ());
+  	  	}
+	    }
+	    alien_prots. sort ();
+  }
+
+
+  static void toProb (double &x)
+  { 
+    QC_ASSERT (x >= 0.0);
+    QC_ASSERT (x <= 100.0);
+    x /= 100.0;
+  }
+    
+    
+  void blastParetoBetter (size_t threads)
+  // Input: target2blastAls
+  // Output: target2goodBlastAls
+  {
+    ASSERT (target2goodBlastAls. empty ());
+	  for (const auto& it : target2blastAls)
+	    target2goodBlastAls [it. first];
+	  forEachTarget<VectorPtr<BlastAlignment>> (target2blastAls, threads, [this] (const string &target, VectorPtr<BlastAlignment> &als)
+	  {
+  	  VectorPtr<BlastAlignment>& vec = target2goodBlastAls. at (target);
+  	  for (const BlastAlignment* blastAl : als)
+  	  {
+        ASSERT (! blastAl->sseqid. empty ());
+      	ASSERT (blastAl->good ());
+      }
+      if (paretoUngrouped)
+      {
+        blastParetoBetter_ungrouped (als, vec);
+        return;
+      }
+      const function<bool (const BlastAlignment*, const BlastAlignment*)> better = [] (const BlastAlignment* a, const BlastAlignment* b) 
+        { return a->better (*b); };
+  	  paretoBetter<BlastAlignment> (als, blastParetoGroups (als), better, vec);
+  	  if (qc_on)
+  	  {
+  	    VectorPtr<BlastAlignment> vec1;
+  	    blastParetoBetter_ungrouped (als, vec1);
+  	    QC_ASSERT (vec1 == vec);
+  	  }
+    });
+    reportDebug ("Pareto-better");
+  }
+
+
+  static void blastParetoBetter_ungrouped (const VectorPtr<BlastAlignment> &als,
+                                           VectorPtr<BlastAlignment> &vec)
+  // Reference implementation of the Pareto-better filtering of blastParetoBetter()
+  // Output: vec
+  // Time: O(als.size()^2)
+  {
+    ASSERT (vec. empty ());
+	  for (const BlastAlignment* blastAl : als)
+	  {
+      ASSERT (blastAl);
+    	ASSERT (blastAl->good ());
+  	  bool found = false;
+  	  for (const BlastAlignment* goodBlastAl : vec)
+  	    if (goodBlastAl->better (*blastAl))
+	      {
+	        found = true;
+	        break;
+	      }
+	    if (found)
+	      continue;	      
+      for (Iter<VectorPtr<BlastAlignment>> goodIter (vec); goodIter. next ();)
+        if (blastAl->better (**goodIter))
+          goodIter. erase ();
+      ASSERT (! blastAl->sseqid. empty ());
+      vec << blastAl;
+    }
+  }
+
+
+  typedef  map<string/*contig*/,IntervalIndex<const BlastAlignment*>>  Contig2index;
+  
+  
+  Contig2index getStopBlastxIndex () const
+  // Return: blastx alignments of target2blastAls with sInternalStop
+  { Contig2index contig2index;
+    for (const auto& it : target2blastAls)
+      for (const BlastAlignment* blastAlX : it. second)
+        if (   blastAlX->blastx ()
+            && blastAlX->sInternalStop
+           )
+          contig2index [blastAlX->sseqid]. add (blastAlX->sInt, blastAlX);
+    for (auto& it : contig2index)
+      it. second. finish ();
+    return contig2index;
+  }
+
+
+  static void setStopCodon (BlastAlignment &blastAlP,
+                            const Contig2index &stopBlastxIndex)  
+  // Input: stopBlastxIndex: getStopBlastxIndex()
+  { 
+    ASSERT (blastAlP. sProt);
+    for (const Locus& cds : blastAlP. cdss)
+      if (! cds. crossOrigin)  // BlastAlignment::matchesCds()
+        if (const IntervalIndex<const BlastAlignment*>* index = findPtr (stopBlastxIndex, cds. contig))
+          index->query ( Interval (cds. start, cds. stop, cds. strand ? 1 : -1)
+                       , BlastAlignment::cdsDist_max
+                       , [&blastAlP] (const BlastAlignment* blastAlX) 
+                           { if (blastAlP. better (*blastAlX))
+                               blastAlP. sInternalStop = true;
+                           }
+                       );
+  }
+    
+    
+#if 0
+  struct Frameshift 
+  {
+    string refName;
+    size_t targetPos {no_index};
+    size_t refPos {no_index};
+    long insertion {0};
+      // %3
+  };
+
+
+  static bool frameshiftSort (const BlastAlignment* al1,
+                              const BlastAlignment* al2)
+  {
+    ASSERT (al1);
+    ASSERT (al2);
+    LESS_PART (*al1, *al2, sseqid);
+    LESS_PART (*al1, *al2, qseqid);
+    LESS_PART (*al1, *al2, sInt. strand);
+    LESS_PART (*al1, *al2, sInt. start);
+    return false;
+  }
+#endif
+                         
+
+  VectorPtr<BlastAlignment> processDisruptions (const VectorPtr<BlastAlignment> &origAls)
+  // Return: new 
+  {
+    ASSERT (! origAls. empty ());
+      
+    Unverbose unv;
+
+    VectorPtr<BlastAlignment> als;  
+
+    VectorPtr<Hsp> origHsps;  origHsps. reserve (origAls. size ());
+    for (const BlastAlignment* al : origAls)
+    {
+      ASSERT (al);
+      if (   al->blastx ()
+          && ! al->isMutationProt ()
+          && al->isStrongSusceptibleProt ()  
+         )
+        origHsps << al;
+      else
+        als << al;
+    }
+
+    Hsp::Merge merge (origHsps, nullptr/*sm*/, 20, true/*bacteria*/);  // PAR
+    for (;;)
+    { 
+      const Hsp* origHsp = nullptr;
+      AlignScore score = - score_inf;
+      Hsp hsp (merge. get (origHsp, score)); 
+      if (hsp. empty ()) 
+        break; 
+      ASSERT (origHsp);
+      auto al = new BlastAlignment (* static_cast <const BlastAlignment*> (origHsp));
+      ASSERT (al->refMutation. empty ());
+      ASSERT (al->seqChanges. empty ());
+      {
+        const lock_guard<mutex> lg (blastAlsMtx);
+        blastAls << al;
+      }
+      * static_cast <Hsp*> (al) = std::move (hsp);
+      al->qc ();
+      als << al;
+    }
+
+    return als;
+  }
+  
+    
+public:
+	void process (bool retainBlasts,
+	              bool skip_hmm_check,
+	              size_t threads) 
+  // Input: target2blastAls, domains, target2hmmAls
+	// Output: target2goodBlastAls
+	// Targets are processed in parallel except in the passes which look at several targets
+	{
+    ASSERT (target2goodBlastAls. empty ());
+    ASSERT (target2goodHmmAls. empty ());
+
+		const Chronometer_OnePass cop ("process", cerr, false, Chronometer::enabled);  
+
+		  		  
+		// Disruption's
+    forEachTarget<VectorPtr<BlastAlignment>> (target2blastAls, threads, [this] (const string &/*target*/, VectorPtr<BlastAlignment> &als)
+    {
+      ASSERT (! als. empty ());
+      if (qc_on)
+      {
+        als. sort ();  
+        ASSERT (als. isUniq ());  
+      }
+      als. sort (Hsp::less); 
+      VectorPtr<BlastAlignment> mergedAls;  
+      {  
+        VectorPtr<BlastAlignment> hsps;  // Subset of als
+        const BlastAlignment* prev = nullptr;
+    	  for (const BlastAlignment* al : als)
+    	  {
+    	    ASSERT (al);
+    	  //ASSERT (al->sseqid == it. first);  // Locus::contig != al->sseqid
+          if (   prev
+              && ! (   al->sseqid       == prev->sseqid
+                    && al->sInt. strand == prev->sInt. strand
+                    && al->qseqid       == prev->qseqid
+                   )
+             )
+    	    {
+    	      mergedAls << processDisruptions (hsps);
+    	      hsps. clear ();
+    	    }
+ 	        hsps << al;
+          prev = al;     
+    	  }
+    	  ASSERT (prev);
+        mergedAls << processDisruptions (hsps);
+      }
+      ASSERT (! mergedAls. empty ());
+      als = mergedAls;      
+      ASSERT (! als. empty ());
+      for (const BlastAlignment* al : als)
+        if (al->isStrongSusceptibleProt ())  
+          for (const Disruption& disr : al->disrs)
+          {
+            var_cast (al) -> seqChanges << std::move (SeqChange (al, disr));
+            break;  // PD-5394
+          }
+    });
+ 	  reportDebug ("Unframeshifted Blasts");
+ 	  
+ 	  
+    forEachTarget<VectorPtr<BlastAlignment>> (target2blastAls, threads, [] (const string &/*target*/, VectorPtr<BlastAlignment> &als)
+    {
+      for (const BlastAlignment* al : als)
+      {
+        ASSERT (al);        
+        if (   ! al->fromHmm 
+            && ! al->sProt
+           )
+          var_cast (al) -> finish ();
+  	    QC_ASSERT ((al->fromHmm || al->inFam ()) == al->completeBR. empty ());
+  	    QC_ASSERT ((al->fromHmm || al->inFam ()) == al->partialBR.  empty ());
+      }
+    });
+ 	  
+ 	  
+ 	#if 0
+    // Declarative frameshifts for mutation proteins  // --> processed as susceptible 
+    for (auto& it : target2blastAls)
+    {
+      VectorPtr<BlastAlignment>& als = it. second;
+      ASSERT (! als. empty ());
+      als. sort (frameshiftSort);      
+      
+      Vector<Frameshift> frameshifts;
+      {
+        // Cf. tblastn2frameshift.cpp
+        constexpr size_t diff_max_aa = 30;  // PAR
+        const BlastAlignment* al_prev = nullptr;
+    	  for (const BlastAlignment* al : als)
+    	  {
+    	    ASSERT (al);
+    	  //ASSERT (al->sseqid == it. first);  // Locus::contig != al->sseqid
+    	    if (al->hasDeclarativeFrameshift ())
+    	      continue;
+    	    if (   al_prev
+    	        && al_prev->blastx ()
+    	        && al->blastx ()
+    	        && al_prev->sseqid       == al->sseqid
+    	        && al_prev->qseqid       == al->qseqid
+    	        && al_prev->sInt. strand == al->sInt. strand
+    	        && difference (al_prev->sInt. stop, al->sInt. start) <= 3 * diff_max_aa
+    	        && (   (al->sInt. strand ==  1 && difference (al_prev->qInt. stop,  al->qInt. start) <= diff_max_aa)
+      	          || (al->sInt. strand == -1 && difference (al_prev->qInt. start, al->qInt. stop)  <= diff_max_aa)
+      	         )
+      	     )
+          {
+            const long diff = al->sStartGlobal () - al_prev->sStartGlobal ();
+            if (diff % 3)  
+              frameshifts << Frameshift { al->qseqid
+                                        , al->sInt. strand == 1 ? al_prev->sInt. stop : (al->sInt. start - al->a2s)
+                                        , al->sInt. strand == 1 ? al_prev->qInt. stop : al->qInt. stop
+                                        , diff
+                                        };
+          }
+    	    al_prev = al;
+    	  }
+    	}
+
+  	  for (const BlastAlignment* al : als)
+  	    if (al->hasDeclarativeFrameshift ())
+    	  {
+    	    ASSERT (al->seqChanges. size () == 1);
+    	    const SeqChange& seqChange = al->seqChanges [0];
+    	    ASSERT (seqChange. hasFrameshift ());
+          const AmrMutation* mut = seqChange. mutations [0];
+          ASSERT (mut);
+          bool found = false;
+          for (const Frameshift& fs : frameshifts)
+            if (   al->qseqid                       == fs. refName
+                && seqChange. start_target          == fs. targetPos
+                && (size_t) mut->pos_std            == fs. refPos
+                && (long) mut->frameshift_insertion == fs. insertion
+               )
+            {
+              found = true;
+              break;
+            }
+          if (! found)
+            var_cast (al) -> seqChanges. clear ();
+    	  }
+    }
+  #endif
+
+
+    forEachTarget<VectorPtr<BlastAlignment>> (target2blastAls, threads, [] (const string &/*target*/, VectorPtr<BlastAlignment> &als)
+      {
+        for (Iter<VectorPtr<BlastAlignment>> iter (als); iter. next ();)
+          if (alien_prots. containsFast ((*iter)->refAccession))
+            iter. erase ();
+      });
+	  reportDebug ("Non-alien Blasts");
+
+
+    forEachTarget<VectorPtr<BlastAlignment>> (target2blastAls, threads, [] (const string &/*target*/, VectorPtr<BlastAlignment> &als)
+      {
+        for (Iter<VectorPtr<BlastAlignment>> iter (als); iter. next ();)
+          if ((*iter)->good ())
+          {
+            ASSERT ((bool) (*iter)->susceptible == (*iter)->isSusceptibleProt ());
+          }
+          else
+            iter. erase ();
+      });
+ 	  reportDebug ("Good Blasts");
+        
+
+	  // PD-2322
+	  // setStopCodon()
+	  {
+	    const Contig2index stopBlastxIndex (getStopBlastxIndex ());
+      for (const auto& it : target2blastAls)
+     	  for (const BlastAlignment* blastAlP : it. second)
+          if (blastAlP->sProt)
+            setStopCodon (* var_cast (blastAlP), stopBlastxIndex);
+   	  for (const HmmAlignment* hmmAl : hmmAls)
+   	  {
+   	    const BlastAlignment* blastAl = hmmAl->blastAl. get ();
+   	    ASSERT (blastAl);
+   	    setStopCodon (* var_cast (blastAl), stopBlastxIndex);  
+   	  }
+   	}
+ 	  if (verbose (-1))
+ 	  {
+ 	    cout << "After setStopCodon():" << endl;
+   	  for (const auto& it : target2blastAls)
+  		  for (const BlastAlignment* blastAl : it. second)
+  		  {
+  		    blastAl->saveText (cout);
+  		    cout << endl;
+  		  }
+  	}
+ 	  
+
+    if (retainBlasts)
+      for (const auto& it : target2blastAls)
+        target2goodBlastAls [it. first] = it. second;
+    else
+      blastParetoBetter (threads);
+
+
+    // Cf. dna_mutation.cpp
+    for (const auto& it : target2goodBlastAls)
+    {
+      SeqChangeIndex seqChangeIndex;
+      for (const BlastAlignment* blastAl : it. second)
+        seqChangeIndex. add (* var_cast (blastAl));
+      seqChangeIndex. setReplacements (true);
+    }
+
+
+    // HMM: Pareto-better()  
+    // target2hmmAls --> target2goodHmmAls
+    for (const auto& it : target2hmmAls)
+      target2goodHmmAls [it. first];
+    forEachTarget<VectorPtr<HmmAlignment>> (target2hmmAls, threads, [this] (const string &target, VectorPtr<HmmAlignment> &als)
+    {
+      VectorPtr<HmmAlignment> hmmAls_ (als);
+      VectorPtr<HmmAlignment>& goodHmmAls = target2goodHmmAls. at (target);
+      goodHmmAls. reserve (hmmAls_. size ());  
+      FOR (unsigned char, criterion, 2)
+      {
+        // hmmAls_ --> goodHmmAls
+        ASSERT (goodHmmAls. empty ());
+    	  for (const HmmAlignment* hmmAl : hmmAls_)
+        {
+          ASSERT (hmmAl);
+        	ASSERT (hmmAl->good ());
+      	  bool found = false;
+      	  for (const HmmAlignment* goodHmmAl : goodHmmAls)
+      	    if (goodHmmAl->better (*hmmAl, criterion))
+    	      {
+    	        found = true;
+    	        break;
+    	      }
+    	    if (found)
+    	      continue;  
+          for (Iter<VectorPtr<HmmAlignment>> goodIter (goodHmmAls); goodIter. next ();)
+            if (hmmAl->better (**goodIter, criterion))
+              goodIter. erase ();
+          goodHmmAls << hmmAl;
+        }
+        reportDebug ("Pareto-better HMMs (Criterion " + to_string ((int) criterion) + ")");
+        if (criterion < 1)
+          hmmAls_ = std::move (goodHmmAls);
+      }
+    });
+
+
+    // No insertions into target2goodHmmAls in the parallel passes
+    for (const auto& it : target2goodBlastAls)
+      target2goodHmmAls [it. first];
+
+
+    // PD-741
+  	if (hmmExist && ! skip_hmm_check)
+  	  forEachTarget<VectorPtr<BlastAlignment>> (target2goodBlastAls, threads, [this] (const string &target, VectorPtr<BlastAlignment> &als)
+  	  {
+  	    unordered_map<string/*sseqid*/,unordered_set<const Fam*>> sseqid2hmmFams;
+  	    for (const HmmAlignment* hmmAl : target2goodHmmAls. at (target))
+  	      sseqid2hmmFams [hmmAl->sseqid]. insert (hmmAl->fam);
+        for (Iter<VectorPtr<BlastAlignment>> iter (als); iter. next ();)
+          if (   (*iter) -> inFam ()
+          	  && (*iter) -> sProt
+              && ! (*iter) -> partial ()
+          	  && (*iter) -> relIdentity () < 0.98 - frac_delta  // PAR  // PD-1673  
+             )
+  	        if (const Fam* fam = checkPtr ((*iter) -> getMatchFam ()) -> getHmmFam ())    
+  	        {
+  	          const unordered_set<const Fam*>* hmmFams = findPtr (sseqid2hmmFams, (*iter) -> sseqid);
+  	          const bool found = hmmFams && contains (*hmmFams, fam);
+  	          if (! found)   // BLAST is wrong
+  	          {
+  	            if (verbose ())
+  	            {
+                  cout << "HMM-wrong:  ";
+                  (*iter) -> saveText (cout); 
+                  cout << endl;
+                }
+  	            iter. erase ();
+  	          }
+  	        }
+  	  });
+    reportDebug ("Best Blasts left");
+
+
+    // PD-2783
+    for (auto& it : target2goodHmmAls)
+    {
+      const VectorPtr<BlastAlignment>& blastAls = target2goodBlastAls [it. first];
+      // Candidates for BlastAlignment::better(const HmmAlignment&): indexes in blastAls
+      unordered_map<string/*sseqid*/,Vector<size_t>> sseqid2prots;
+      IntervalIndex<size_t> dnaIndex;
+      FFOR (size_t, i, blastAls. size ())
+      {
+        const BlastAlignment* blastAl = blastAls [i];
+        if (! blastAl->inFam ())
+          continue;
+        if (blastAl->sProt)
+          sseqid2prots [blastAl->sseqid] << i;
+        else
+          dnaIndex. add (blastAl->sInt, i);
+      }
+      dnaIndex. finish ();
+      for (Iter<VectorPtr<HmmAlignment>> hmmIt (it. second); hmmIt. next ();)
+      {
+        Vector<size_t> candidates;
+        if (const Vector<size_t>* prots = findPtr (sseqid2prots, (*hmmIt) -> sseqid))
+          candidates = *prots;
+        for (const Locus& cds : (*hmmIt) -> blastAl->cdss)
+          if (   cds. contig == it. first
+              && ! cds. crossOrigin
+             )
+            dnaIndex. query ( Interval (cds. start, cds. stop, cds. strand ? 1 : -1)
+                            , BlastAlignment::cdsDist_max
+                            , [&candidates] (size_t i) { candidates << i; }
+                            );
+        candidates. sort ();
+        candidates. uniq ();
+    	  for (const size_t i : candidates)
+    	    if (blastAls [i] -> better (**hmmIt))
+  	      {
+  	        var_cast (blastAls [i]) -> hmmAl = *hmmIt;
+            hmmIt. erase ();
+  	        break;
+  	      }
+  	  }
+  	}
+    reportDebug ("HMMs non-suppressed by BLAST");
+
+
+ 	  forEachTarget<VectorPtr<BlastAlignment>> (target2goodBlastAls, threads, [this] (const string &target, VectorPtr<BlastAlignment> &als)
+ 	    {
+        // HmmAlignment::better(const BlastAlignment&) requires the same sseqid
+        unordered_map<string/*sseqid*/,VectorPtr<HmmAlignment>> sseqid2hmmAls;
+        for (const HmmAlignment* hmmAl : target2goodHmmAls. at (target))
+          sseqid2hmmAls [hmmAl->sseqid] << hmmAl;
+        for (Iter<VectorPtr<BlastAlignment>> blastIt (als); blastIt. next ();)
+          if (   (*blastIt) -> inFam ()
+              && (*blastIt) -> sProt
+             )
+            if (const VectorPtr<HmmAlignment>* hmmAls_ = findPtr (sseqid2hmmAls, (*blastIt) -> sseqid))
+          	  for (const HmmAlignment* hmmAl : *hmmAls_)
+          	    if (hmmAl->better (**blastIt))
+        	      {
+                  blastIt. erase ();
+        	        break;
+        	      }
+      });
+    reportDebug ("Best HMMs left");
+
+
+    // Output 
+    
+    // goodHmmAls --> target2goodBlastAls
+    for (const auto& it : target2goodHmmAls)
+    	for (const HmmAlignment* hmmAl : it. second)
+    	{
+    	  const BlastAlignment* blastAl = hmmAl->blastAl. get ();
+    	  ASSERT (blastAl);
+    	  target2goodBlastAls [it. first] << blastAl;
+    	}
+  	
+    // PD-2394
+    // BlastAlignment::{fusions,fusionRedundant}
+ 	  for (auto& it : target2goodBlastAls)
+ 	  {
+ 	    auto& goodBlastAls_ = it. second;
+      goodBlastAls_. sort (BlastAlignment::less);  
+      {
+        const BlastAlignment* prev = nullptr;
+        const BlastAlignment* fusionMain = nullptr;
+        for (const BlastAlignment* blastAl : goodBlastAls_)
+        {
+          if (! blastAl->inFam () /*blastAl->isMutationProt ()*/)
+            continue;
+          if (blastAl->fromHmm)
+            continue;
+          if (   prev 
+              && prev->sameMatch (blastAl)
+             )
+          {
+            QC_ASSERT (blastAl->parts == prev->parts);
+            QC_ASSERT (blastAl->part  >= prev->part);
+            if (blastAl->part == prev->part)  // multi-domain tccP problem, PD-4217
+              fusionMain = nullptr;
+            else
+            {
+              QC_ASSERT (blastAl->parts >= 2);
+              if (! fusionMain)
+              {
+                fusionMain = prev;
+                var_cast (fusionMain) -> fusions << fusionMain;
+              }
+              ASSERT (fusionMain);
+              var_cast (fusionMain) -> fusions << blastAl;
+              var_cast (blastAl) -> fusionRedundant = true;
+            }
+          }
+          else
+            fusionMain = nullptr;
+          prev = blastAl;
+        }
+      }
+    }
+
+    reportDebug ("After process()");
+	}
+	
+	
+	void reportDebug (const string &header) const
+  {
+    if (! verbose ())
+      return;
+    
+    cout << endl;
+    
+    cout << header << " (target2blastAls):" << endl;
+ 	  for (const auto& it : target2blastAls)
+		  for (const BlastAlignment* blastAl : it. second)
+		  {
+		    cout << it. first << ": ";
+		    blastAl->saveText (cout);
+		    cout << endl;
+		  }
+		cout << endl;
+		  
+    cout << header << " (target2goodBlastAls):" << endl;
+ 	  for (const auto& it : target2goodBlastAls)
+		  for (const BlastAlignment* blastAl : it. second)
+		  {
+		    cout << it. first << ": ";
+		    blastAl->saveText (cout);
+		    cout << endl;
+		  }
+		cout << endl;
+		  
+    cout << header << " (target2hmmAls):" << endl;
+ 	  for (const auto& it : target2hmmAls)
+		  for (const HmmAlignment* hmmAl : it. second)
+		  {
+		    cout << it. first << ": ";
+		    hmmAl->saveText (cout);
+		  }
+		cout << endl;
+
+    cout << header << " (target2goodHmmAls):" << endl;
+ 	  for (const auto& it : target2goodHmmAls)
+		  for (const HmmAlignment* hmmAl : it. second)
+		  {
+		    cout << it. first << ": ";
+		    hmmAl->saveText (cout);
+		  }
+		cout << endl;
+
+		cout << endl;
+	}
+		
+	
+	void report (TsvOut &td,
+	             bool mutationAll) const
+	// Input: target2goodBlastAls
+	{
+	  ASSERT (td. empty ());
+	  	  
+		const Chronometer_OnePass cop ("report", cerr, false, Chronometer::enabled);  
+		
+		reportHeader (td);
+		reportTargets (td, mutationAll);
+	}
+	
+	
+	void reportHeader (TsvOut &td) const
+	{
+    // PD-283, PD-780
+  	// Cf. BlastAlignment::report()
+    if (! input_name. empty ())
+      td << "Name";
+    // Target
+    td << prot_colName;                          //  1  // sseqid 
+    if (cdsExist)  
+      // Contig (target)
+      td << contig_colName                       //  2
+         << start_colName                        //  3
+         << stop_colName                         //  4
+         << strand_colName;                      //  5
+    // Reference
+    td << genesymbol_colName                     //  6 or 2  
+       << elemName_colName                       //  7 or 3
+       << scope_colName                          //  8 or 4       
+       << type_colName                           //  9 or 5
+       << subtype_colName                        // 10 or 6
+       << class_colName                          // 11 or 7
+       << subclass_colName                       // 12 or 8
+       << method_colName                         // 13 or 9
+       // target
+       << targetLen_colName                      // 14 or 10       
+       //
+       << refLen_colName                         // 15 or 11  // qlen
+       << refCov_colName                         // 16 or 12  // queryCoverage
+       << refIdent_colName                       // 17 or 13 
+       << alignLen_colName                       // 18 or 14  // sseq.size()
+       << closestRefAccession_colName            // 19 or 15  // refAccession
+       << closestRefName_colName                 // 20 or 16
+       //
+       << hmmAccession_colName                   // 21 or 17
+       << hmmDescr_colName                       // 22 or 18
+       ;
+    if (cdsExist)
+    	if (useCrossOrigin)
+      	 td << "Cross-origin length";
+    if (print_node)
+      td << hierarchyNode_colName; 
+    td. newLn ();
+  }
+  
+  
+  void reportTargets (TsvOut &td,
+                      bool mutationAll) const
+	// Input: target2goodBlastAls
+  {
+ 	  for (const auto& it : target2goodBlastAls)
+    	for (const BlastAlignment* blastAl : it. second)
+    	{
+    	  ASSERT (blastAl);
+     	  blastAl->qc ();
+   	  	if (   ! blastAl->seqChanges. empty ()
+   	  	    || (   (   blastAl->fusion2reportable () >= reportable_min
+     	              || blastAl->alleleReportable ()
+     	             )
+     	          && ! suppress_prots. containsFast (blastAl->refAccession)
+     	          && ! blastAl->fusionRedundant
+     	         )
+     	     )
+       	  blastAl->report (td, it. first, mutationAll);
+      }
+	}
+
+
+	void getTargetIds (StringVector &targetIds) const
+	// Update: targetIds
+	{
+ 	  for (const auto& it : target2goodBlastAls)
+    	for (const BlastAlignment* blastAl : it. second)
+    	  if (   blastAl->sProt
+    	  	  && ! blastAl->isMutationProt ()
+    	  	  && blastAl->fusion2reportable () >= reportable_min
+    	  	 )
+          targetIds << blastAl->sseqid;
+	}
+	
+	
+	void clearTargets ()
+	// Frees the target input and output
+	// Requires: no HMM input
+	{
+	  ASSERT (hmmAls. empty ());
+	  target2blastAls. clear ();
+	  target2goodBlastAls. clear ();
+	  target2hmmAls. clear ();
+	  target2goodHmmAls. clear ();
+	  blastAls. deleteData ();
+	}
+};
+
+
+
+
+// HmmAlignment
+
+HmmAlignment::HmmAlignment (const string &line,
+                            const Batch &batch)
+{
+  static Istringstream iss;
+  iss. reset (line);
+  string hmm, dummy;
+  //                                                        --- full sequence ---  --- best 1 domain --
+  //     target name  accession  query name     accession   E-value  score     bias     E-value  score  bias   exp reg clu  ov env dom rep inc description of target
+  iss >> sseqid >>    dummy      >> dummy      >> hmm >>    dummy >> score1 >> dummy >> dummy >> score2;
+  QC_ASSERT (score1 > 0);
+  QC_ASSERT (score2 > 0)
+  find (hmm2fam, hmm, fam);
+  if (! fam)
+    throw runtime_error ("No family for HMM " + hmm);
+}
+
+
+
+
+// Domain
+
+HmmAlignment::Domain::Domain (const string &line,
+                              Batch &batch)
+{
+  static Istringstream iss;
+  iss. reset (line);
+  string target_name, accession, query_name, query_accession;
+  size_t n, of, env_from, env_to;
+  double eValue, full_score, full_bias, cValue, i_eValue, domain_bias, accuracy;
+  iss >> target_name >> accession >> seqLen 
+      >> query_name >> query_accession >> hmmLen 
+      >> eValue >> full_score >> full_bias 
+      >> n >> of >> cValue >> i_eValue >> score >> domain_bias 
+      >> hmmStart >> hmmStop 
+      >> seqStart >> seqStop 
+      >> env_from >> env_to
+      >> accuracy;
+  QC_ASSERT (accession == "-");
+  QC_ASSERT (hmmStart);
+  QC_ASSERT (seqStart);
+  QC_ASSERT (env_from);
+  hmmStart--;
+  seqStart--;
+  env_from--;
+  QC_ASSERT (hmmStart < hmmStop);
+  QC_ASSERT (seqStart < seqStop);
+  QC_ASSERT (hmmStop <= hmmLen);
+  QC_ASSERT (seqStop <= seqLen);
+  QC_ASSERT (full_score > 0);
+  QC_ASSERT (n >= 1);
+  QC_ASSERT (n <= of);
+  QC_ASSERT (score > 0);
+
+  const Fam* fam = nullptr;
+  find (hmm2fam, query_accession, fam);
+  if (! fam)
+    return;
+  const HmmAlignment::Pair p (target_name, fam->id);
+  const HmmAlignment::Domain domain_old (batch. domains [p]);
+  if (domain_old. score > score)
+    return;
+  batch. domains [p] = *this;
+}
+
+
+
+constexpr size_t blastBufSize = 1 << 20;  // PAR
+
+
+
+BlastAlignment* parseBlastAlignment (const string &line,
+                                     bool sProt,
+                                     bool nosame)
+// Return: new, nullptr if the alignment is skipped
+{ 
+  unique_ptr<BlastAlignment> al (new BlastAlignment (line, sProt));
+  al->qc ();  
+  if (nosame && al->refAccession == al->sseqid)
+    return nullptr;
+  return al. release ();
+}
+
+
+
+void readBlastAlignments (const string &fName,
+                          bool sProt,
+                          bool nosame,
+                          size_t threads,
+                          VectorOwn<BlastAlignment> &blastAls)
+// BlastAlignment's are constructed in parallel in blocks of lines, the order of fName is preserved
+// Input: fName: Hsp::format [true]
+// Output: blastAls: appended
+{
+  constexpr size_t threadLines = 1000;  // PAR
+  
+  const auto parse = [sProt, nosame] (const string &line) 
+    { return parseBlastAlignment (line, sProt, nosame); };
+    
+  LineInput f (fName, blastBufSize, 0);
+  
+  if (threads <= 1 || verbose ())
+  {
+	  while (f. nextLine ())
+	  {
+	    { 
+	      Unverbose unv;
+	      if (verbose ())
+	        cout << f. line << endl;  
+	    }
+	    if (const BlastAlignment* al = parse (f. line))
+	      blastAls << al;
+	  }
+	  return;
+	}
+	
+	StringVector lines;  lines. reserve (threads * threadLines);
+	Vector<VectorOwn<BlastAlignment>> results (threads);
+	vector<exception_ptr> errors (threads);
+	const auto parseRange = [&lines, &results, &errors, &parse] (size_t tn, size_t from, size_t to)
+	  { try
+	    { 
+	      for (size_t i = from; i < to; i++)
+	        if (const BlastAlignment* al = parse (lines [i]))
+	          results [tn] << al;
+	    }
+	    catch (...)
+	    {
+	      errors [tn] = current_exception ();
+	    }
+	  };
+	while (! f. eof)
+	{
+	  lines. clear ();
+	  while (lines. size () < threads * threadLines && f. nextLine ())
+  	  lines << std::move (f. line);
+  	// Contiguous ranges
+  	const size_t chunk = (lines. size () + threads - 1) / threads;
+  	{
+  	  vector<thread> th;
+  	  FOR_START (size_t, tn, 1, threads)
+  	    if (tn * chunk < lines. size ())
+  	      th. push_back (thread (parseRange, tn, tn * chunk, min (lines. size (), (tn + 1) * chunk)));
+  	  parseRange (0, 0, min (lines. size (), chunk));
+  	  for (thread& t : th)
+  	    t. join ();
+  	}
+  	for (const exception_ptr& e : errors)
+  	  if (e)
+  	    rethrow_exception (e);
+  	for (VectorOwn<BlastAlignment>& res : results)
+  	{
+  	  blastAls << res;
+  	  res. clear ();
+  	}
+	}
+}
+
+
+
+void streamBlastxAlignments (const string &fName,
+                             bool nosame,
+                             Batch &batch,
+                             const function<void ()> &processTarget)
+// Input: fName: Hsp::format [true], sorted by sseqid (LC_ALL=C)
+// Invokes: processTarget() when batch.{blastAls,target2blastAls} have all alignments of one target
+// Requires: batch.blastAls.empty()
+{
+  ASSERT (batch. blastAls. empty ());
+  
+  string target;
+  const auto flush = [&batch, &target, &processTarget] ()
+    { if (batch. blastAls. empty ())
+        return;
+      VectorPtr<BlastAlignment>& als = batch. target2blastAls [target];
+      for (const BlastAlignment* al : batch. blastAls)
+        als << al;
+      processTarget ();
+    };
+
+  LineInput f (fName, blastBufSize, 0);
+  while (f. nextLine ())
+  {
+    { 
+      Unverbose unv;
+      if (verbose ())
+        cout << f. line << endl;  
+    }
+    const BlastAlignment* al = parseBlastAlignment (f. line, false, nosame);
+    if (! al)
+      continue;
+    ASSERT (! al->sseqid. empty ());
+    if (al->sseqid != target)
+    {
+      if (al->sseqid < target)
+      {
+        delete al;
+        throw runtime_error (fName + " is not sorted by contig, " + f. lineStr ());
+      }
+      flush ();
+      target = al->sseqid;
+    }
+    batch. blastAls << al;
+  }
+  flush ();
+}
+
+
+
+
+}  // namespace
+
+
+
+
+namespace AmrReport_sp
+{
+
+
+void amrReport (const AmrReport &par,
+                AmrReportResult &res)
+{
+  static_assert (complete_coverage_min_def > partial_coverage_min_def, "complete_coverage_min_def > partial_coverage_min_def");
+
+  // The global variables are shared by all invocations
+  static mutex mtx;
+  const lock_guard<mutex> lg (mtx);
+
+  const string& famFName             = par. famFName;
+  const string& blastpFName          = par. blastpFName;
+  const string& blastxFName          = par. blastxFName;
+  const string& gffFName             = par. gffFName;
+  const Gff::Type gffType            = par. gffType;
+  const string& gffProtMatchFName    = par. gffProtMatchFName;
+  const string& gffDnaMatchFName     = par. gffDnaMatchFName;
+  const bool    lcl                  = par. lcl;
+  const bool    bedP                 = par. bedP;
+  const string& dnaLenFName          = par. dnaLenFName;
+  const string& hmmDom               = par. hmmDom;
+  const string& hmmsearch            = par. hmmsearch;  
+        string  organism             = par. organism;  
+  const string& mutation_tab         = par. mutation_tab;  
+  const string& susceptible_tab      = par. susceptible_tab;  
+  const string& suppress_prot_FName  = par. suppress_prot_FName;
+        double  ident_min            = par. ident_min;  
+  const double  partial_coverage_min = par. partial_coverage_min;  
+  const bool    skip_hmm_check       = par. skip_hmm_check; 
+                equidistant          = par. equidistant;
+                print_node           = par. print_node;
+                print_node_raw       = par. print_node_raw;
+  const bool    force_cds_report     = par. force_cds_report;
+  const bool    non_reportable       = par. non_reportable;
+  const bool    report_core_only     = par. report_core_only;
+                input_name           = par. name;
+  const bool    nosame               = par. nosame;
+  const bool    noblast              = par. noblast;
+  const bool    nohmm                = par. nohmm;
+  const bool    retainBlasts         = par. retainBlasts;
+                paretoUngrouped      = par. paretoUngrouped;
+  
+  replace (organism, '_', ' ');
+  
+  QC_ASSERT (hmmsearch. empty () == hmmDom. empty ());
+  QC_IMPLY (par. targetIds, ! blastpFName. empty ());
+  QC_IMPLY (! gffFName. empty (), ! blastpFName. empty ());
+  if (! blastpFName. empty () && ! blastxFName. empty () && gffFName. empty ())
+  	throw runtime_error ("If BLASTP and BLASTX files are present then a GFF file must be present");
+  	
+  if (gffFName. empty ())
+  {
+    QC_ASSERT (gffProtMatchFName. empty ());
+    QC_ASSERT (gffDnaMatchFName. empty ());
+    QC_ASSERT (gffType == Gff::genbank);
+    QC_ASSERT (! lcl);
+    QC_ASSERT (! bedP);
+  }
+  
+  QC_IMPLY (print_node_raw, print_node);
+         			  
+  
+  // defaultCompleteBR, defaultPartialBR, ident_min_user
+  {
+    ident_min_user = false;
+    if (ident_min == -1.0)
+      ident_min = ident_min_def;
+    else
+      ident_min_user = true;
+      
+    if (! (ident_min >= 0.0 && ident_min <= 1.0))
+    	throw runtime_error ("-ident_min must be -1 or between 0 and 1");
+    if (! (partial_coverage_min >= 0.0 && partial_coverage_min <= 1.0))
+    	throw runtime_error ("-coverage_min must be -1 or between 0 and 1");    	
+    if (partial_coverage_min > complete_coverage_min_def)
+      throw runtime_error ("-coverage_min must be less than " + toString (complete_coverage_min_def) + " - threshod for complete matches");
+      
+    defaultCompleteBR = BlastRule (ident_min, complete_coverage_min_def);  
+    defaultPartialBR  = BlastRule (ident_min, partial_coverage_min);
+  }
+  
+  
+  targetProt = true;
+  cdsExist =    force_cds_report
+             || ! blastxFName. empty ()
+             || ! gffFName. empty ();
+  
+  
+		const Chronometer_OnePass cop1 ("amr_report", cerr, false, Chronometer::enabled);  
+
+
+  unique_ptr<Batch> batchOwn (new Batch (famFName, organism, mutation_tab, susceptible_tab, suppress_prot_FName, non_reportable, report_core_only));
+  Batch& batch = *batchOwn;
+  
+  const auto teardown = [&par, &batchOwn] ()
+    { if (par. skipTeardown)
+        batchOwn. release ();
+      else
+      {
+        batchOwn. reset ();
+        BlastAlignment::pool. clear ();
+        HmmAlignment::pool. clear ();
+      }
+    };
+    
+    
+  if (par. streaming)
+  {
+    if (   blastxFName. empty ()
+        || ! blastpFName. empty ()
+        || ! gffFName. empty ()
+        || ! hmmsearch. empty ()
+        || noblast
+       )
+      throw runtime_error ("Streaming requires a BLASTX file and no BLASTP, GFF or HMM files");
+		const Chronometer_OnePass cop ("streaming", cerr, false, Chronometer::enabled);  
+    targetProt = false;
+    res = std::move (AmrReportResult ());
+    {
+      TsvOut td (res. report, 2, false);
+      td. usePound = false;
+      batch. reportHeader (td);
+      unique_ptr<TsvOut> tdAll;
+      if (par. mutation_all)
+      {
+        tdAll. reset (new TsvOut (res. mutation_all, 2, false));
+        tdAll->usePound = false;
+        batch. reportHeader (*tdAll);
+      }
+      streamBlastxAlignments (blastxFName, nosame, batch, [&] () 
+        { batch. process (retainBlasts, skip_hmm_check, par. threads);
+          batch. reportTargets (td, false);
+          if (tdAll)
+            batch. reportTargets (*tdAll, true);
+          batch. clearTargets ();
+        });
+    }
+    res. report. setHeader ();
+    if (par. mutation_all)
+      res. mutation_all. setHeader ();
+    teardown ();
+    return;
+  }
+
+
+  // Input 
+
+  // batch.{blastAls,target2blastAls}
+	ASSERT (batch. blastAls. empty ());
+	ASSERT (batch. target2blastAls. empty ());
+  if (   ! noblast
+      && ! blastpFName. empty ()
+     )
+  {
+		const Chronometer_OnePass cop ("blastp", cerr, false, Chronometer::enabled);
+		readBlastAlignments (blastpFName, true, nosame, par. threads, batch. blastAls);
+		for (const BlastAlignment* al : batch. blastAls)
+		{
+      ASSERT (! al->sseqid. empty ());
+      batch. target2blastAls [al->sseqid] << al;
+    }
+	}
+	if (verbose ())
+	  cout << "# Blasts: " << batch. blastAls. size () << endl;
+	
+
+  if (! nohmm)
+  {
+    // batch.domains
+    if (! hmmDom. empty ())
+    {
+  		const Chronometer_OnePass cop ("hmmDom", cerr, false, Chronometer::enabled);  
+    	batch. hmmExist = true;
+      LineInput f (hmmDom);
+  	  while (f. nextLine ())
+  	  {
+  	    trim (f. line);
+  	    if (   f. line. empty () 
+  	        || f. line [0] == '#'
+  	       )
+  	      continue;
+  	    const HmmAlignment::Domain domain (f. line, batch);
+  	  }
+    }
+
+    // batch.{hmmAls,target2hmmAls}
+  	// HmmAlignment::good()
+  	if (! hmmsearch. empty ())  
+  	{
+  		const Chronometer_OnePass cop ("hmmsearch", cerr, false, Chronometer::enabled); 
+      LineInput f (hmmsearch);
+  	  while (f. nextLine ())
+  	  {
+  	    if (verbose ())
+  	      cout << f. line << endl;  
+  	    if (f. line. empty () || f. line [0] == '#')
+  	      continue;
+  	    unique_ptr<HmmAlignment> hmmAl (new HmmAlignment (f. line, batch));
+  	    if (! hmmAl->good ())
+  	    {
+  	      if (verbose ())
+  	      {
+  	        cout << "  Bad HMM: " << endl;
+  	        hmmAl->saveText (cout);
+  	      }
+  	    	continue;
+  	    }
+ 	      const BlastAlignment* bestBlastAl = nullptr;  // PD-3475
+  	    if (const VectorPtr<BlastAlignment>* blastAls_ = findPtr (batch. target2blastAls, hmmAl->sseqid))
+  	    {
+  	      size_t nident_max = 0;
+  	      for (const BlastAlignment* blastAl : *blastAls_)
+  	      {
+  	        ASSERT (blastAl->sseqid == hmmAl->sseqid);
+  	        if (maximize (nident_max, blastAl->nident))
+  	          bestBlastAl = blastAl;
+  	      }
+  	    }
+  	    auto al = new BlastAlignment (*hmmAl, bestBlastAl);
+	  	  hmmAl->blastAl. reset (al);
+	  	  if (verbose ())
+	  	    cout << al->sseqid << " " << al->gene << endl;  
+	  	  const HmmAlignment::Domain domain = batch. domains [HmmAlignment::Pair (al->sseqid, al->gene)];
+	  	  if (! domain. hmmLen)  
+	  	    continue;  // domain does not exist
+ 	  	    if (! bestBlastAl)  // Stand-alone HMM hit
+	  	  {
+  	  	/*al->qlen        = domain. hmmLen;
+  	  	  al->qstart      = domain. hmmStart;
+  	  	  al->qend        = domain. hmmStop; */
+  	  	  al->slen        = domain. seqLen;
+  	  	  al->sInt. start = domain. seqStart;
+  	  	  al->sInt. stop  = domain. seqStop;
+  	  	//ASSERT (! al->refExactlyMatched ());
+  	  	//ASSERT (! al->partial ());
+    	  }
+	  	  al->qc ();
+	  	  batch. target2hmmAls [hmmAl->sseqid] << hmmAl. get ();  
+	      batch. hmmAls                        << hmmAl. release ();
+  	  }
+  	}
+  }
+ 	if (verbose ())
+ 	  cout << "# Good initial HMMs: " << batch. hmmAls. size () << endl;
+
+
+  if (   ! noblast
+      && ! blastxFName. empty ()
+     )       
+  {
+		const Chronometer_OnePass cop ("blastx", cerr, false, Chronometer::enabled);  
+		readBlastAlignments (blastxFName, false, nosame, par. threads, batch. blastAls);
+	}
+	if (verbose ())
+	  cout << "# Blasts: " << batch. blastAls. size () << endl;
+
+
+  // For Batch::report()
+  if (! gffFName. empty ())
+  {
+    const Chronometer_OnePass cop ("gff", cerr, false, Chronometer::enabled);  
+  	unique_ptr<const Annot> annot;
+  	if (bedP)
+  	{
+  	  QC_ASSERT (gffProtMatchFName. empty ());
+  	  QC_ASSERT (gffDnaMatchFName. empty ());
+  	  QC_ASSERT (! lcl);
+		    annot. reset (new Annot (gffFName));
+		  }
+  	else
+  	{
+		    annot. reset (new Annot (gffFName, gffType, ! gffProtMatchFName. empty (), lcl));
+	    if (! gffProtMatchFName. empty ())
+  		  var_cast (annot. get ()) -> load_fasta2gff_prot (gffProtMatchFName);	
+	    if (! gffDnaMatchFName. empty ())
+  		  var_cast (annot. get ()) -> load_fasta2gff_dna (gffDnaMatchFName);	
+		  }
+		  ASSERT (annot);
+	    {
+	      // Locus::contigLen
+	    map<string,size_t> contig2len;
+	    if (! dnaLenFName. empty ())
+	    {
+	      LineInput f (dnaLenFName);
+	      string contig;
+	      size_t len;
+	      Istringstream iss;
+	      while (f. nextLine ())
+	      {
+	        iss. reset (f. line);
+	        len = 0;
+	        iss >> contig >> len;
+	        QC_ASSERT (len);
+	        contig2len [contig] = len;
+	      }
+	      for (const auto& it : annot->prot2loci)
+	        for (const Locus& locus : it. second)
+	          if (! locus. contigLen)
+	            var_cast (locus). contigLen = contig2len [locus.contig];
+	    }
+	  }
+  	for (const BlastAlignment* al : batch. blastAls)
+  	  if (al->sProt)
+   	  	var_cast (al) -> setCdss (*annot);
+	    for (const HmmAlignment* hmmAl : batch. hmmAls)
+      var_cast (hmmAl->blastAl. get ()) -> setCdss (*annot);
+  }
+  
+    
+  if (! blastxFName. empty ())
+  {
+		const Chronometer_OnePass cop ("target2...", cerr, false, Chronometer::enabled);  
+    targetProt = false;
+    // batch.target2blastAls
+    // Proteins in BLASTP which are not in GFF are ignored
+    batch. target2blastAls. clear ();  
+  	for (const BlastAlignment* al : batch. blastAls)
+      if (al->sProt)
+  	    for (const string& contig : al->getContigs ())
+  	      batch. target2blastAls [contig] << al;
+  	  else
+        batch. target2blastAls [al->sseqid] << al;
+    // batch.target2hmmAls
+    batch. target2hmmAls. clear ();
+  	for (const HmmAlignment* hmmAl : batch. hmmAls)
+	  {
+	    ASSERT (hmmAl);
+	    ASSERT (hmmAl->blastAl);
+ 	    for (const string& contig : hmmAl->blastAl->getContigs ())
+	      batch. target2hmmAls [contig] << hmmAl;
+	  }
+  }      
+
+
+  batch. process (retainBlasts, skip_hmm_check, par. threads);    
+
+
+  // Output
+  res = std::move (AmrReportResult ());
+  {
+    TsvOut td (res. report, 2, false);
+    td. usePound = false;
+    batch. report (td, false);
+  }
+  res. report. setHeader ();
+  if (par. mutation_all)
+  {
+    TsvOut td (res. mutation_all, 2, false);
+    td. usePound = false;
+    batch. report (td, true);
+    res. mutation_all. setHeader ();
+  }
+  if (par. targetIds)
+    batch. getTargetIds (res. targetIds);
+    
+  teardown ();
+}
+
+
+
+}  // namespace
@@ -0,0 +1,141 @@
+// amrreport.hpp
+
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE                          
+*               National Center for Biotechnology Information
+*                                                                          
+*  This software/database is a "United States Government Work" under the   
+*  terms of the United States Copyright Act.  It was written as part of    
+*  the author's official duties as a United States Government employee and 
+*  thus cannot be copyrighted.  This software/database is freely available 
+*  to the public for use. The National Library of Medicine and the U.S.    
+*  Government have not placed any restriction on its use or reproduction.  
+*                                                                          
+*  Although all reasonable efforts have been taken to ensure the accuracy  
+*  and reliability of the software and data, the NLM and the U.S.          
+*  Government do not and cannot warrant the performance or results that    
+*  may be obtained by using this software or data. The NLM and the U.S.    
+*  Government disclaim all warranties, express or implied, including       
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.                                                                
+*                                                                          
+*  Please cite the author in any work or product based on this material.   
+*
+* ===========================================================================
+*
+* Author: Vyacheslav Brover
+*
+* File Description:
+*   Identification of AMR genes using BLAST and HMM search results vs. the AMRFinderPlus database
+*
+*/
+
+
+#ifndef AMRREPORT_HPP
+#define AMRREPORT_HPP
+
+
+#include "common.hpp"
+using namespace Common_sp;
+#include "tsv.hpp"
+#include "gff.hpp"
+using namespace GFF_sp;
+
+
+
+namespace AmrReport_sp
+{
+
+
+constexpr double ident_min_def = 0.9;
+constexpr double complete_coverage_min_def = 0.9;
+constexpr double partial_coverage_min_def  = 0.5;
+
+
+
+struct AmrReport
+// Parameters of amrReport()
+// Cf. amr_report.cpp
+{
+  // Input
+  string famFName;
+  string blastpFName;
+  string blastxFName;
+  string gffFName;
+  Gff::Type gffType {Gff::genbank};
+  string gffProtMatchFName;
+  string gffDnaMatchFName;
+  bool lcl {false};
+  bool bedP {false};
+  string dnaLenFName;
+  string hmmDom;
+  string hmmsearch;
+  string organism;
+    // '_' = ' '
+  string mutation_tab;
+  string susceptible_tab;
+  string suppress_prot_FName;
+  double ident_min {-1.0};
+    // -1 <=> curated threshold or ident_min_def
+  double partial_coverage_min {partial_coverage_min_def};
+  bool skip_hmm_check {false};
+  bool equidistant {false};
+
+  // Output
+  bool mutation_all {false};
+  bool targetIds {false};
+  bool print_node {false};
+  bool print_node_raw {false};
+  bool force_cds_report {false};
+  bool non_reportable {false};
+  bool report_core_only {false};
+  string name;
+  
+  // Resources
+  size_t threads {1};
+    // For parsing BLAST output
+  bool skipTeardown {false};
+    // The process exits after amrReport(): the alignments are not freed
+  bool streaming {false};
+    // blastxFName is sorted by contig and is processed contig by contig
+    // Memory is bounded by the alignments of one contig
+    // Requires: no BLASTP, GFF and HMM input
+
+  // Testing
+  bool nosame {false};
+  bool noblast {false};
+  bool nohmm {false};
+  bool retainBlasts {false};
+  bool paretoUngrouped {false};
+    // Pareto-better filtering of BLAST alignments by the original quadratic algorithm without grouping
+};
+
+
+
+struct AmrReportResult
+{
+  TextTable report;
+  TextTable mutation_all;
+    // Valid if AmrReport::mutation_all
+  StringVector targetIds;
+    // Reported input proteins
+    // Valid if AmrReport::targetIds
+};
+
+
+
+void amrReport (const AmrReport &par,
+                AmrReportResult &res);
+  // Output: res
+  // Column names are in columns.hpp
+  // Thread-safe: invocations are serialized
+  // Reference data (fam, mutation and susceptible tables) are re-read only if their files or thresholds change
+
+
+
+}  // namespace
+
+
+
+#endif
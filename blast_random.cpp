@@ -0,0 +1,398 @@
+// blast_random.cpp
+
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* Author: Vyacheslav Brover
+*
+* File Description:
+*   Random reference database and BLAST alignments for testing amr_report
+*
+*/
+
+
+#undef NDEBUG
+
+#include "common.hpp"
+using namespace Common_sp;
+
+#include "common.inc"
+
+
+
+namespace
+{
+
+
+const string aminoacids ("ACDEFGHIKLMNPQRSTVWY");
+
+
+
+struct Generator
+{
+  Rand rand;
+
+
+  explicit Generator (ulong seed)
+    : rand (seed)
+    {}
+
+
+  size_t get (size_t min,
+              size_t max)
+    // Return: min .. max
+    { ASSERT (min <= max);
+      return min + (size_t) rand. get ((ulong) (max - min + 1));
+    }
+  char aa ()
+    { return aminoacids [get (0, aminoacids. size () - 1)]; }
+  string protein (size_t len)
+    // Return: starts with 'M'
+    { ASSERT (len);
+      string s ("M");
+      while (s. size () < len)
+        s += aa ();
+      return s;
+    }
+  string mutate (const string &s,
+                 double rate)
+    // Mutates s[1..] except '*'
+    { string res (s);
+      FFOR_START (size_t, i, 1, res. size ())
+        if (res [i] != '*' && rand. getProb () < rate)
+          res [i] = aa ();
+      return res;
+    }
+};
+
+
+
+struct Ref
+{
+  string qseqid;
+  string seq;
+    // Ends with '*'
+  size_t family {no_index};
+    // no_index <=> mutation protein
+};
+
+
+
+struct Target
+// Protein aligned to the segment [start, stop) of a reference
+{
+  string id;
+  size_t ref {no_index};
+  size_t start {0};
+  size_t stop {0};
+  string seq;
+};
+
+
+
+struct Gene
+// Target on a contig
+{
+  const Target* target {nullptr};
+  size_t start {0};
+  bool strand {true};
+  bool annotated {true};
+    // false <=> blastx alignments only
+  bool adjacent {false};
+    // Next to an annotated gene
+};
+
+
+
+struct ThisApplication final : Application
+{
+  ThisApplication ()
+    : Application ("Make a random reference database and BLAST alignments for testing amr_report.\n\
+Output files in <dir>: fam.tsv, mutation.tsv, susceptible.tsv, blastp, blastx, gff, len")
+    {
+  	  addPositional ("dir", "Output directory");
+  	  addKey ("families", "Number of protein families", "10");
+  	  addKey ("proteins", "Number of target proteins", "100");
+  	  addKey ("contigs", "Number of contigs", "3");
+
+ 	    version = SVN_REV;
+    }
+
+
+
+	void body () const final
+  {
+	  const string dir      = getArg ("dir");
+	  const size_t families = str2<size_t> (getArg ("families"));
+	  const size_t proteins = str2<size_t> (getArg ("proteins"));
+	  const size_t contigs  = str2<size_t> (getArg ("contigs"));
+	  QC_ASSERT (families);
+	  QC_ASSERT (contigs);
+
+	  // PAR
+	  constexpr size_t mutationProts = 2;
+	  constexpr size_t mutationsPerProt = 3;
+
+	  Generator gen (seed_global);
+
+
+	  // Reference database
+	  Vector<Ref> refs;
+	  {
+	    OFStream fam (dir + "/fam.tsv");
+	    fam << "#fam" << endl;
+	    const auto addFam = [&fam] (const string &famId,
+	                                const string &parent,
+	                                const string &genesymbol,
+	                                size_t reportable)
+	      { fam << famId << '\t' << parent << '\t' << genesymbol << "\t-\t0\t0\t0\t0\t0\t0\t0\t0\t" << reportable
+	            << "\tAMR\tAMR\tBETA-LACTAM\tCEPHALOSPORIN\tproduct of " << famId << endl;
+	      };
+	    addFam ("ALL", "", "-", 0);
+	    FFOR (size_t, f, families)
+	    {
+	      const string famId ("FAM" + to_string (f));
+	      const string gene ("gene" + to_string (f));
+	      addFam (famId, "ALL", gene, 1 + f % 2);
+	      const string ancestor (gen. protein (gen. get (30, 300)));
+	      const size_t alleles = gen. get (1, 4);
+	      FFOR (size_t, i, alleles)
+	      {
+	        string famId_ref (famId);
+	        if (! (i % 2))
+	        {
+	          famId_ref = gene + "-" + to_string (i + 1);
+	          addFam (famId_ref, famId, famId_ref, 2);
+	        }
+	        Ref ref;
+	        ref. qseqid = "WP_" + pad (to_string (refs. size () + 1), 9, etrue, '0') + ".1|1|1|" + famId_ref + "|" + gene + "|AMR|2|CEPH|BETA-LACTAM|product_of_" + famId_ref;
+	        ref. seq = gen. mutate (ancestor, 0.1) + "*";
+	        ref. family = f;
+	        refs << std::move (ref);
+	      }
+	    }
+	  }
+	  {
+  	  OFStream mut (dir + "/mutation.tsv");
+  	  mut << "#taxgroup\taccession\tpos\tstd\treport\tclass\tsubclass\tname" << endl;
+  	  FFOR (size_t, m, mutationProts)
+  	  {
+  	    const string acc ("WP_M" + pad (to_string (m + 1), 8, etrue, '0') + ".1");
+  	    const string gene ("gyr" + to_string (m));
+  	    Ref ref;
+  	    ref. qseqid = acc + "|1|1|" + gene + "|" + gene + "|mutation|2|QUINOLONE|QUINOLONE|" + gene + "_mutant";
+  	    ref. seq = gen. protein (gen. get (150, 300)) + "*";
+  	    FFOR (size_t, i, mutationsPerProt)
+  	    {
+  	      const size_t pos = gen. get (5, ref. seq. size () - 6);
+  	      char alt = ref. seq [pos];
+  	      while (alt == ref. seq [pos])
+  	        alt = gen. aa ();
+  	      const string name (gene + "_" + ref. seq [pos] + to_string (pos + 1) + alt);
+  	      mut << "Escherichia\t" << acc << '\t' << pos + 1 << '\t' << name << '\t' << name << "\tQUINOLONE\tQUINOLONE\tEscherichia_quinolone_resistant" << endl;
+  	    }
+  	    refs << std::move (ref);
+  	  }
+  	}
+	  {
+	    OFStream sus (dir + "/susceptible.tsv");
+	    sus << "#taxgroup\tgenesymbol\taccession\tcutoff\tclass\tsubclass\tname" << endl;
+	  }
+
+
+	  // Targets
+	  Vector<Target> targets;  targets. reserve (proteins);
+	  FFOR (size_t, t, proteins)
+	  {
+	    Target target;
+	    target. id = "prot" + to_string (t + 1);
+	    target. ref = gen. get (0, refs. size () - 1);
+	    const string& refSeq = refs [target. ref]. seq;
+	    const size_t len = refSeq. size ();
+	    target. stop = len;
+	    if (gen. get (0, 2) == 0)  // Partial
+	    {
+	      target. start = gen. get (0, len / 3);
+	      target. stop  = gen. get (2 * len / 3, len);
+	    }
+	    static const double rates [] = {0.0, 0.01, 0.05, 0.2};
+	    target. seq = gen. mutate (refSeq. substr (target. start, target. stop - target. start), rates [gen. get (0, 3)]);
+	    if (refs [target. ref]. family == no_index)
+	      FFOR (size_t, i, target. seq. size ())
+	        if (i && target. seq [i] != '*' && gen. get (0, 9) == 0)
+	          target. seq [i] = gen. aa ();
+	    targets << std::move (target);
+	  }
+
+	  const auto hitRefs = [&refs] (const Target &target)
+	    // Return: indexes in refs
+	    { Vector<size_t> res;
+	      const size_t family = refs [target. ref]. family;
+	      if (family == no_index)
+	        res << target. ref;
+	      else
+	        FFOR (size_t, i, refs. size ())
+	          if (refs [i]. family == family)
+	            res << i;
+	      return res;
+	    };
+	  const auto printHits = [&refs, &hitRefs] (ostream &os,
+	                                            const Target &target,
+	                                            const string &sseqid,
+	                                            size_t sstart,
+	                                            size_t send,
+	                                            size_t slen)
+	    { for (const size_t i : hitRefs (target))
+	      {
+	        const Ref& ref = refs [i];
+	        const string qseq (ref. seq. substr (target. start, target. stop - target. start));
+	        ASSERT (qseq. size () == target. seq. size ());
+	        size_t ident = 0;
+	        FFOR (size_t, j, qseq. size ())
+	          if (qseq [j] == target. seq [j])
+	            ident++;
+	        if (i != target. ref && 2 * ident < qseq. size ())
+	          continue;
+	        os         << ref. qseqid
+	           << '\t' << sseqid
+	           << '\t' << target. start + 1
+	           << '\t' << target. stop
+	           << '\t' << ref. seq. size ()
+	           << '\t' << sstart
+	           << '\t' << send
+	           << '\t' << slen
+	           << '\t' << qseq
+	           << '\t' << target. seq
+	           << endl;
+	      }
+	    };
+
+
+	  // blastp
+	  {
+	    OFStream f (dir + "/blastp");
+	    for (const Target& target : targets)
+	      printHits (f, target, target. id, 1, target. seq. size (), target. seq. size ());
+	  }
+
+
+	  // Contigs
+	  // Close genes make the Pareto-better groups of amr_report non-trivial
+	  Vector<Vector<Gene>> contig2genes (contigs);
+	  for (const Target& target : targets)
+	    contig2genes [gen. get (0, contigs - 1)] << Gene {& target, 0, true, true, false};
+	  Vector<size_t> contig2annotated;
+	  for (const Vector<Gene>& genes : contig2genes)
+	    contig2annotated << genes. size ();
+	  // Short blastx alignments next to the genes interact with them without overlapping
+	  Vector<Target> fragments;  fragments. reserve (contigs * (proteins / 3 + 1));
+	  FFOR (size_t, c, contigs)
+	  {
+	    const size_t n = contig2annotated [c];
+	    FFOR (size_t, i, gen. get (0, n / 5 + 1))
+	      contig2genes [c] << Gene {& targets [gen. get (0, targets. size () - 1)], 0, true, false, false};
+	    FFOR (size_t, i, n ? gen. get (0, n / 3 + 1) : 0)
+	    {
+	      Target fragment (targets [gen. get (0, targets. size () - 1)]);
+	      const size_t len = min<size_t> (gen. get (3, 60), fragment. seq. size ());
+	      const size_t start = gen. get (0, fragment. seq. size () - len);
+	      fragment. seq = fragment. seq. substr (start, len);
+	      fragment. start += start;
+	      fragment. stop = fragment. start + len;
+	      fragments << std::move (fragment);
+	      contig2genes [c] << Gene {& fragments. back (), 0, true, false, true};
+	    }
+	  }
+	  {
+	    OFStream gff (dir + "/gff");
+	    OFStream blastx (dir + "/blastx");
+	    OFStream lenF (dir + "/len");
+	    gff << "##gff-version 3" << endl;
+	    FFOR (size_t, c, contigs)
+	    {
+	      const string contig ("contig" + to_string (c + 1));
+	      size_t pos = gen. get (0, 300);
+	      Vector<Gene>& genes = contig2genes [c];
+	      const size_t n = contig2annotated [c];
+	      FFOR (size_t, i, genes. size ())
+	      {
+	        Gene& gene = genes [i];
+	        const size_t len = 3 * gene. target->seq. size ();
+	        gene. strand = gen. get (0, 1);
+	        if (gene. annotated)
+	        {
+  	        gene. start = pos;
+  	        pos += len + gen. get (0, 400);
+	        }
+	        else if (gene. adjacent)
+	        {
+	          ASSERT (n);
+	          const Gene& neighbor = genes [gen. get (0, n - 1)];
+	          // BlastAlignment::insideEq() tolerates 30 bp
+	          const size_t gap = gen. get (0, 1) ? gen. get (0, 30) : gen. get (0, 200);
+	          if (gen. get (0, 1) && neighbor. start >= len + gap)
+	            gene. start = neighbor. start - len - gap;
+	          else
+	            gene. start = neighbor. start + 3 * neighbor. target->seq. size () + gap;
+	          if (gen. get (0, 2))
+	            gene. strand = neighbor. strand;
+	        }
+	        else
+	          gene. start = pos > len ? gen. get (0, pos - len) : 0;
+	      }
+	      const size_t contigLen = pos + 500;
+	      for (const Gene& gene : genes)
+	      {
+	        const size_t len = 3 * gene. target->seq. size ();
+	        const size_t start = gene. start + 1;
+	        const size_t stop  = gene. start + len;
+	        ASSERT (stop <= contigLen);
+	        if (gene. annotated)
+	          gff << contig << "\t.\tCDS\t" << start << '\t' << stop << "\t.\t" << (gene. strand ? '+' : '-') << "\t0\tID=cds_" << gene. target->id << ";Name=" << gene. target->id << endl;
+	        if (gene. strand)
+	          printHits (blastx, *gene. target, contig, start, stop, contigLen);
+	        else
+	          printHits (blastx, *gene. target, contig, stop, start, contigLen);
+	      }
+	      lenF << contig << '\t' << contigLen << endl;
+	    }
+	  }
+  }
+};
+
+
+
+}  // namespace
+
+
+
+int main (int argc,
+          const char* argv[])
+{
+  ThisApplication app;
+  return app. run (argc, argv);
+}
+
+
+
@@ -48,6 +48,10 @@
 	  #include <sys/stat.h>
 	  #include <unistd.h>
 	  #include <dirent.h>
+	  #include <fcntl.h>
+	  #include <spawn.h>
+	  #include <sys/wait.h>
+	  extern char** environ;
 	  #ifdef __APPLE__
 	    #include <sys/sysctl.h>
 	  #endif
@@ -1113,6 +1117,61 @@ string rfindSplit (string &s,
 
 
 
+string_view findSplit (string_view &s,
+                       char c)
+{
+	const size_t pos = s. find (c);
+	if (pos == string_view::npos)
+	{
+		const string_view s1 (s);
+		s = string_view ();
+		return s1;
+	}
+	const string_view before (s. substr (0, pos));
+	s. remove_prefix (pos + 1);
+	return before;
+}
+
+
+
+string_view rfindSplit (string_view &s,
+                        char c)
+{
+	const size_t pos = s. rfind (c);
+	if (pos == string_view::npos)
+	{
+		const string_view s1 (s);
+		s = string_view ();
+		return s1;
+	}
+	const string_view after (s. substr (pos + 1));
+	s. remove_suffix (s. size () - pos);
+	return after;
+}
+
+
+
+string_view nextWord (string_view &s)
+{
+  constexpr const char* delims = " \t";
+  const size_t start = s. find_first_not_of (delims);
+  if (start == string_view::npos)
+  {
+    s = string_view ();
+    return s;
+  }
+  s. remove_prefix (start);
+  const size_t end = s. find_first_of (delims);
+  const string_view word (s. substr (0, end));
+  if (end == string_view::npos)
+    s = string_view ();
+  else
+    s. remove_prefix (end);
+  return word;
+}
+
+
+
 void reverse (string &s)
 {
   FFOR (size_t, i, s. size () / 2)
@@ -1723,18 +1782,42 @@ Unverbose::~Unverbose ()
 
 //
 
+namespace
+{
+  
+mutex execLogMtx;
+  // exec() and execLines() are invoked by concurrent threads
+
+
+void execLog (const string &cmd,
+              const string &s)
+// Output: cout if verbose(), *logPtr
+{
+  const lock_guard<mutex> lg (execLogMtx);
+  if (s. empty ())
+  {
+    if (verbose ())
+    	cout << cmd << endl;
+    LOG (cmd);
+  }
+  else
+    LOG (cmd + "\n" + s);
+}
+
+}
+
+
+
 void exec (const string &cmd,
            const string &logFName)
 {
   ASSERT (! cmd. empty ());
 
 //Chronometer_OnePass cop (cmd);
-  if (verbose ())
-  	cout << cmd << endl;
-  LOG (cmd);
+  execLog (cmd, noString);
 
 	const int status = system (cmd. c_str ());  // pipefail's are not caught
-	LOG ("status = " + to_string (status));
+	execLog (cmd, "status = " + to_string (status));
 	if (status)
 	{
 	  string err (cmd + "\nstatus = " + to_string (status));
@@ -1750,6 +1833,103 @@ void exec (const string &cmd,
 
 
 #ifndef _MSC_VER
+void execLines (const string &cmd,
+                const function<void (const string &line)> &processLine,
+                const string &logFName)
+{
+  ASSERT (! cmd. empty ());
+
+  execLog (cmd, noString);
+
+  // Other threads' children must not inherit the pipe: it is close-on-exec from the start
+  int fd [2];
+#if defined (__linux__) || defined (__FreeBSD__)
+  if (pipe2 (fd, O_CLOEXEC))
+    throw runtime_error ("Cannot create a pipe for:\n" + cmd);
+#else
+  // No pipe2(): a child forked by another thread between pipe() and fcntl() inherits the pipe
+  if (pipe (fd))
+    throw runtime_error ("Cannot create a pipe for:\n" + cmd);
+  if (   fcntl (fd [0], F_SETFD, FD_CLOEXEC) == -1
+      || fcntl (fd [1], F_SETFD, FD_CLOEXEC) == -1
+     )
+  {
+    close (fd [0]);
+    close (fd [1]);
+    throw runtime_error ("Cannot set close-on-exec on a pipe for:\n" + cmd);
+  }
+#endif
+  
+  pid_t pid = 0;
+  int spawnErr = 0;
+  {
+    posix_spawn_file_actions_t actions;
+    spawnErr = posix_spawn_file_actions_init (& actions);
+    if (! spawnErr)
+    {
+      // dup2() clears close-on-exec of STDOUT_FILENO
+      spawnErr = posix_spawn_file_actions_adddup2 (& actions, fd [1], STDOUT_FILENO);
+      if (! spawnErr)
+      {
+        const char* argv [] = {"sh", "-c", cmd. c_str (), nullptr};
+        spawnErr = posix_spawn (& pid, "/bin/sh", & actions, nullptr, const_cast<char* const*> (argv), environ);
+      }
+      posix_spawn_file_actions_destroy (& actions);
+    }
+  }
+  close (fd [1]);
+  if (spawnErr)
+  {
+    close (fd [0]);
+    throw runtime_error ("Cannot start:\n" + cmd + "\nerror = " + to_string (spawnErr));
+  }
+
+  exception_ptr eptr;
+  {
+    FILE* f = fdopen (fd [0], "r");
+    ASSERT (f);
+    char* buf = nullptr;
+    size_t bufSize = 0;
+    string line;
+    for (;;)
+    {
+      const ssize_t len = getline (& buf, & bufSize, f);
+      if (len == -1)
+        break;
+      line. assign (buf, (size_t) len);
+      if (! line. empty () && line. back () == '\n')
+        line. pop_back ();
+      try { processLine (line); }
+        catch (...) 
+        { eptr = current_exception ();
+          break;
+        }
+    }
+    free (buf);
+    fclose (f);
+  }
+  
+  int status = 0;
+  while (waitpid (pid, & status, 0) == -1)
+    if (errno != EINTR)
+      throw runtime_error ("Cannot wait for:\n" + cmd);
+	execLog (cmd, "status = " + to_string (status));
+  if (eptr)
+    rethrow_exception (eptr);
+	if (status)
+	{
+	  string err (cmd + "\nstatus = " + to_string (status));
+	  if (! logFName. empty ())
+	  {
+	    const StringVector vec (logFName, (size_t) 10, false);  // PAR
+	    err += "\n" + vec. toString ("\n");
+	  }
+		throw runtime_error (err);
+	}
+}
+
+
+
 string which (const string &progName)
 {
   ASSERT (! progName. empty ());
@@ -2912,8 +3092,12 @@ void BraceInput::skipComment ()
 
 // IFStream
 
-IFStream::IFStream (const string &pathName)
+IFStream::IFStream (const string &pathName,
+                    char* buf,
+                    size_t bufSize)
 {
+  if (buf)
+    rdbuf () -> pubsetbuf (buf, (streamsize) bufSize);
   switch (getFiletype (pathName, true))
   {
     case Filetype::none: throw runtime_error ("Cannot open " + shellQuote (pathName));
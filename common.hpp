@@ -62,6 +62,8 @@
 #include <cstring>
 #include <cmath>
 #include <string>
+#include <string_view>
+#include <charconv>
 #include <stdexcept>
 #include <limits>
 #include <array>
@@ -82,6 +84,7 @@
 #include <filesystem>
 
 #include <thread>
+#include <atomic>
 #ifdef _MSC_VER
 	#pragma warning(push)
 	#pragma warning(disable:4265)
@@ -706,6 +709,22 @@ template <typename T>
         catch (...) { return false; } 
     }
 
+template <typename T>
+  T view2int (string_view s)
+  // Faster than str2<T>()
+  // Input: s: decimal digits with an optional '-'; otherwise str2<T>() is used
+    { static_assert (is_integral<T>::value, "view2int works on integers");
+      T i = 0;
+      const char* end = s. data () + s. size ();
+      const from_chars_result r = from_chars (s. data (), end, i);
+      if (   s. empty ()
+          || r. ec != errc ()
+          || r. ptr != end
+         )
+        return str2<T> (string (s));
+      return i;
+    }
+
 void commaize (string &s);
   // ' ' --> ','
 
@@ -897,6 +916,17 @@ string rfindSplit (string &s,
 	// Return: suffix of c+s after c
 	// Update: s
 
+// No copying
+string_view findSplit (string_view &s,
+                       char c);
+string_view rfindSplit (string_view &s,
+                        char c);
+
+string_view nextWord (string_view &s);
+  // Words are separated by spaces and tabs
+  // Return: empty() <=> no more words
+  // Update: s
+
 void reverse (string &s);
 
 size_t strMonth2num (const string& month);
@@ -1745,7 +1775,13 @@ struct IFStream : ifstream
 // Text file
 {
   IFStream () = default;
-	explicit IFStream (const string &pathName);
+	explicit IFStream (const string &pathName)
+	  : IFStream (pathName, nullptr, 0)
+	  {}
+	IFStream (const string &pathName,
+	          char* buf,
+	          size_t bufSize);
+	  // Input: buf[bufSize]: nullptr <=> default buffer; must exist while *this is open
 };
 
 
@@ -1813,6 +1849,13 @@ void exec (const string &cmd,
   // Input: logFName: log file populated by cmd, to include into exception::what() if cmd fails
 
 #ifndef _MSC_VER
+  void execLines (const string &cmd,
+                  const function<void (const string &line)> &processLine,
+                  const string &logFName = noString);
+    // Input: cmd: its stdout is read by lines while cmd is running
+    //        processLine: line has no '\n'
+    //        logFName: as in exec()
+    // Uses posix_spawn() and a pipe, no temporary file
   string which (const string &progName);
     // Return: isRight(,"/") or empty() if there is no path
 #endif
@@ -3091,6 +3134,156 @@ template <typename T /* : Root */>
 
 
 
+struct BlockPool : Nocopy
+// Memory for many objects of the same class: operator new/delete of the class
+// Blocks are cut from large slabs, deallocated blocks are reused
+// Each thread has its own free list, blocks move between it and the shared pool in batches
+// Requires: static storage duration
+{
+private:
+  static constexpr size_t slabBlocks = 1024;  // PAR
+  static constexpr size_t batchBlocks = 64;  // PAR
+  static constexpr size_t pools_max = 4;  // PAR
+    // Number of BlockPool's used by one thread
+  
+  struct Local
+  {
+    BlockPool* pool {nullptr};
+    size_t generation {0};
+    void* freeList {nullptr};
+    size_t size {0};
+      // Of freeList
+  };
+  struct Locals
+  {
+    array<Local,pools_max> arr;
+   ~Locals ()
+      { for (Local& local : arr)
+          if (local. pool)
+            local. pool->putBack (local, local. size);
+      }
+  };
+  
+  mutex mtx;
+    // Protects the data below
+  const size_t blockSize;
+  vector<unique_ptr<char[]>> slabs;
+  size_t slabFree {0};
+    // Never allocated blocks at the end of slabs.back()
+  void* freeList {nullptr};
+  atomic<size_t> generation {0};
+    // Incremented by clear(): Local::freeList of an older generation points to freed slabs
+  atomic<size_t> used {0};
+public:
+  
+
+  explicit BlockPool (size_t size)
+    : blockSize (((max (size, sizeof (void*)) - 1) / alignof (max_align_t) + 1) * alignof (max_align_t))
+    {}
+  
+  
+  void* allocate (size_t size)
+    { if (size > blockSize)
+        throwf ("BlockPool: size > blockSize");
+      Local& local = getLocal ();
+      if (! local. freeList)
+        takeBatch (local);
+      void* p = local. freeList;
+      local. freeList = * static_cast<void**> (p);
+      local. size--;
+      used++;
+      return p;
+    }
+  void deallocate (void* p) noexcept
+    // Invoked by operator delete: no exceptions
+    { if (! p)
+        return;
+      if (! used)
+        errorExit ("BlockPool: deallocating a free block", true);
+      used--;
+      Local& local = getLocal ();
+      * static_cast<void**> (p) = local. freeList;
+      local. freeList = p;
+      local. size++;
+      if (local. size >= 2 * batchBlocks)
+        putBack (local, batchBlocks);
+    }
+  void clear ()
+    // Frees all slabs at once
+    // Requires: all blocks are deallocated, no other thread uses *this
+    { const lock_guard<mutex> lg (mtx);
+      if (used)
+        throwf ("BlockPool: blocks are in use");
+      slabs. clear ();
+      slabFree = 0;
+      freeList = nullptr;
+      generation++;
+    }
+private:
+  Local& getLocal () noexcept
+    { thread_local Locals locals;
+      Local* empty = nullptr;
+      for (Local& local : locals. arr)
+        if (local. pool == this)
+        {
+          if (local. generation != generation)
+          {
+            local. generation = generation;
+            local. freeList = nullptr;
+            local. size = 0;
+          }
+          return local;
+        }
+        else if (! local. pool && ! empty)
+          empty = & local;
+      if (! empty)
+        errorExit ("BlockPool: too many pools", true);
+      empty->pool = this;
+      empty->generation = generation;
+      return *empty;
+    }
+  void takeBatch (Local &local)
+    // Output: local.freeList: batchBlocks blocks
+    { const lock_guard<mutex> lg (mtx);
+      for (size_t i = 0; i < batchBlocks; i++)
+      {
+        void* p = freeList;
+        if (p)
+          freeList = * static_cast<void**> (p);
+        else
+        {
+          if (! slabFree)
+          {
+            slabs. push_back (unique_ptr<char[]> (new char [blockSize * slabBlocks]));
+            slabFree = slabBlocks;
+          }
+          p = slabs. back (). get () + blockSize * (slabBlocks - slabFree);
+          slabFree--;
+        }
+        * static_cast<void**> (p) = local. freeList;
+        local. freeList = p;
+        local. size++;
+      }
+    }
+  void putBack (Local &local,
+                size_t n) noexcept
+    // Moves n blocks from local.freeList to freeList
+    { const lock_guard<mutex> lg (mtx);
+      if (local. generation != generation)
+        return;
+      for (size_t i = 0; i < n && local. freeList; i++)
+      {
+        void* p = local. freeList;
+        local. freeList = * static_cast<void**> (p);
+        local. size--;
+        * static_cast<void**> (p) = freeList;
+        freeList = p;
+      }
+    }
+};
+
+
+
 enum SetOperation {soIntersect, soUnion, soMinus};
 
 
@@ -3963,6 +4156,8 @@ public:
 struct Input : Root, Nocopy
 {
 protected:
+  unique_ptr<char[]> buf;
+    // Before ifs
   IFStream ifs;
   istream* is {nullptr};
     // ifs.is_open() => is = &ifs
@@ -3981,6 +4176,14 @@ protected:
     , is (& ifs)
     , prog (0, displayPeriod)  
     {}
+  Input (const string &fName,
+         size_t bufSize,
+         uint displayPeriod)
+    : buf (new char [bufSize])
+    , ifs (fName, buf. get (), bufSize)
+    , is (& ifs)
+    , prog (0, displayPeriod)  
+    {}
   Input (istream &is_arg,
 	       uint displayPeriod);
 public:
@@ -4004,6 +4207,12 @@ struct LineInput : Input
           	          uint displayPeriod = 0)
     : Input (fName, displayPeriod)
     {}
+	LineInput (const string &fName,
+	           size_t bufSize,
+          	 uint displayPeriod)
+    : Input (fName, bufSize, displayPeriod)
+    {}
+    // For large files
   explicit LineInput (istream &is_arg,
 	                    uint displayPeriod = 0)
     : Input (is_arg, displayPeriod)
@@ -0,0 +1,552 @@
+// dbsnapshot.cpp
+
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE                          
+*               National Center for Biotechnology Information
+*                                                                          
+*  This software/database is a "United States Government Work" under the   
+*  terms of the United States Copyright Act.  It was written as part of    
+*  the author's official duties as a United States Government employee and 
+*  thus cannot be copyrighted.  This software/database is freely available 
+*  to the public for use. The National Library of Medicine and the U.S.    
+*  Government have not placed any restriction on its use or reproduction.  
+*                                                                          
+*  Although all reasonable efforts have been taken to ensure the accuracy  
+*  and reliability of the software and data, the NLM and the U.S.          
+*  Government do not and cannot warrant the performance or results that    
+*  may be obtained by using this software or data. The NLM and the U.S.    
+*  Government disclaim all warranties, express or implied, including       
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.                                                                
+*                                                                          
+*  Please cite the author in any work or product based on this material.   
+*
+* ===========================================================================
+*
+* Author: Vyacheslav Brover
+*
+* File Description:
+*   Binary snapshot of the tables of the AMRFinderPlus database
+*
+*/
+
+   
+   
+
+#undef NDEBUG 
+
+#include "dbsnapshot.hpp"
+
+#include <sys/stat.h>
+
+#include "common.inc"
+
+
+
+namespace DbSnapshot_sp
+{
+
+
+namespace 
+{
+  
+
+void writeStr (ostream &os,
+               const string &s)
+{
+  const uint len = (uint) s. size ();
+  QC_ASSERT (len == s. size ());
+  writeBin (os, len);
+  os. write (s. c_str (), len);
+}
+
+
+
+streamsize bytesLeft (istream &is)
+// Return: number of bytes from the current position to the end of is, -1 if unknown
+{
+  const streampos pos = is. tellg ();
+  if (pos == streampos (-1))
+    return -1;
+  is. seekg (0, ios_base::end);
+  const streampos end = is. tellg ();
+  is. seekg (pos);
+  if (end == streampos (-1))
+    return -1;
+  return end - pos;
+}
+
+
+
+void readStr (istream &is,
+              string &s)
+// Sets failbit of is if the length is greater than the rest of is
+{
+  uint len = 0;
+  readBin (is, len);
+  if (! is. good ())
+    return;
+  if ((streamsize) len > bytesLeft (is))
+  {
+    is. setstate (ios_base::failbit);
+    return;
+  }
+  s. resize (len);
+  is. read (& s [0], len);
+}
+
+
+
+template <typename Row>
+  void writeRows (ostream &os,
+                  const Vector<Row> &rows)
+  {
+    writeBin (os, (size_t) rows. size ());
+    for (const Row& row : rows)
+      row. save (os);
+  }
+
+
+
+template <typename Row>
+  void readRows (istream &is,
+                 Vector<Row> &rows)
+  {
+    size_t n = 0;
+    readBin (is, n);
+    if (! is. good ())
+      return;
+    // A row takes more than 1 byte
+    const streamsize left = bytesLeft (is);
+    if (left < 0 || n > (size_t) left)
+    {
+      is. setstate (ios_base::failbit);
+      return;
+    }
+    rows. resize (n);
+    for (Row& row : rows)
+      row. read (is);
+  }
+
+
+
+bool getFileStamp (const string &fName,
+                   streamsize &size,
+                   time_t &mtime,
+                   uint64_t &inode)
+// Return: success
+{
+  struct stat st;
+  if (::stat (fName. c_str (), & st))
+    return false;
+  size  = (streamsize) st. st_size;
+  mtime = st. st_mtime;
+  inode = (uint64_t) st. st_ino;
+  return true;
+}
+
+
+
+const string magic ("AMRFinderPlus database snapshot");
+
+
+}  // namespace
+
+
+
+
+// FamRow
+
+void FamRow::save (ostream &os) const
+{
+  writeStr (os, id);
+  writeBin (os, parent);
+  writeStr (os, genesymbol);
+  writeStr (os, hmm);
+  writeBin (os, tc1);
+  writeBin (os, tc2);
+  writeBin (os, complete_ident);
+  writeBin (os, complete_target_coverage);
+  writeBin (os, complete_ref_coverage);
+  writeBin (os, partial_ident);
+  writeBin (os, partial_target_coverage);
+  writeBin (os, partial_ref_coverage);
+  writeBin (os, reportable);
+  writeStr (os, type);
+  writeStr (os, subtype);
+  writeStr (os, classS);
+  writeStr (os, subclass);
+  writeStr (os, familyName);
+}
+
+
+
+void FamRow::read (istream &is)
+{
+  readStr (is, id);
+  readBin (is, parent);
+  readStr (is, genesymbol);
+  readStr (is, hmm);
+  readBin (is, tc1);
+  readBin (is, tc2);
+  readBin (is, complete_ident);
+  readBin (is, complete_target_coverage);
+  readBin (is, complete_ref_coverage);
+  readBin (is, partial_ident);
+  readBin (is, partial_target_coverage);
+  readBin (is, partial_ref_coverage);
+  readBin (is, reportable);
+  readStr (is, type);
+  readStr (is, subtype);
+  readStr (is, classS);
+  readStr (is, subclass);
+  readStr (is, familyName);
+}
+
+
+
+
+// MutationRow
+
+void MutationRow::save (ostream &os) const
+{
+  writeStr (os, organism);
+  writeStr (os, accession);
+  writeBin (os, pos);
+  writeStr (os, geneMutation_std);
+  writeStr (os, geneMutation_report);
+  writeStr (os, classS);
+  writeStr (os, subclass);
+  writeStr (os, name);
+}
+
+
+
+void MutationRow::read (istream &is)
+{
+  readStr (is, organism);
+  readStr (is, accession);
+  readBin (is, pos);
+  readStr (is, geneMutation_std);
+  readStr (is, geneMutation_report);
+  readStr (is, classS);
+  readStr (is, subclass);
+  readStr (is, name);
+}
+
+
+
+
+// SusceptibleRow
+
+void SusceptibleRow::save (ostream &os) const
+{
+  writeStr (os, organism);
+  writeStr (os, genesymbol);
+  writeStr (os, accession);
+  writeBin (os, cutoff);
+  writeStr (os, classS);
+  writeStr (os, subclass);
+  writeStr (os, name);
+}
+
+
+
+void SusceptibleRow::read (istream &is)
+{
+  readStr (is, organism);
+  readStr (is, genesymbol);
+  readStr (is, accession);
+  readBin (is, cutoff);
+  readStr (is, classS);
+  readStr (is, subclass);
+  readStr (is, name);
+}
+
+
+
+
+// Parsing
+
+Vector<FamRow> readFams (const string &fName)
+{
+  Vector<FamRow> rows;
+  unordered_map<string/*id*/,size_t/*index in rows*/> id2index;
+  StringVector parentIds;
+    // Parallel to rows
+  {
+    LineInput f (fName);  
+	  while (f. nextLine ())
+	    try
+	  	{
+	  	  trim (f. line);
+	  	  if (   f. line. empty () 
+	  	      || f. line [0] == '#'
+	  	     )
+	  	    continue;
+	  	  FamRow row;
+	  	  row. id                       = findSplit (f. line, '\t');
+	  	  parentIds << findSplit (f. line, '\t');
+	  	  row. genesymbol               = findSplit (f. line, '\t');
+	  	  row. hmm                      = findSplit (f. line, '\t');
+	  	  row. tc1                      = str2<double> (findSplit (f. line, '\t'));
+	  	  row. tc2                      = str2<double> (findSplit (f. line, '\t'));
+        row. complete_ident           = str2<double> (findSplit (f. line, '\t')); 
+        row. complete_target_coverage = str2<double> (findSplit (f. line, '\t')); 
+        row. complete_ref_coverage    = str2<double> (findSplit (f. line, '\t')); 
+        row. partial_ident            = str2<double> (findSplit (f. line, '\t')); 
+        row. partial_target_coverage  = str2<double> (findSplit (f. line, '\t')); 
+        row. partial_ref_coverage     = str2<double> (findSplit (f. line, '\t')); 
+        for (const double x : {row. complete_ident, row. complete_target_coverage, row. complete_ref_coverage,
+                               row. partial_ident,  row. partial_target_coverage,  row. partial_ref_coverage})
+        {
+          QC_ASSERT (x >= 0.0);
+          QC_ASSERT (x <= 100.0);
+        }
+  		  QC_ASSERT (! row. complete_ident == ! row. partial_ident);
+	  	  row. reportable = (uchar) str2<int> (findSplit (f. line, '\t'));
+	  	  row. type                     = findSplit (f. line, '\t');
+	  	  row. subtype                  = findSplit (f. line, '\t');
+	  	  row. classS                   = findSplit (f. line, '\t');
+	  	  row. subclass                 = findSplit (f. line, '\t');
+	  	  row. familyName               = f. line;
+	  	  if (! id2index. insert ({row. id, rows. size ()}). second)
+	  	    throw runtime_error ("Family " + row. id + " is duplicated");
+	  	  rows << std::move (row);
+	  	}
+	  	catch (const exception &e)
+	  	{
+	  	  throw runtime_error ("Cannot read " + fName +", " + f. lineStr () + "\n" + e. what ());
+	  	}
+	}
+	ASSERT (parentIds. size () == rows. size ());
+	
+	FFOR (size_t, i, rows. size ())
+	{
+	  const string& parentId = parentIds [i];
+	  if (parentId. empty ())
+	    continue;
+	  const auto it = id2index. find (parentId);
+	  if (it == id2index. end ())
+	    throw runtime_error ("parentFamId " + strQuote (parentId) + " is not found in famId2fam for child " + strQuote (rows [i]. id));
+	  rows [i]. parent = it->second;
+	}
+	
+	return rows;
+}
+
+
+
+Vector<MutationRow> readMutations (const string &fName,
+                                   bool organismP)
+{
+  Vector<MutationRow> rows;
+  LineInput f (fName);
+  Istringstream iss;
+  while (f. nextLine ())
+  {
+    if (isLeft (f. line, "#"))
+      continue;
+    try
+    {
+      MutationRow row;
+      int pos = 0;
+      iss. reset (f. line);
+      if (organismP)
+        iss >> row. organism;
+      iss >> row. accession >> pos >> row. geneMutation_std >> row. geneMutation_report >> row. classS >> row. subclass >> row. name;
+      QC_ASSERT (pos > 0);
+      QC_ASSERT (! row. name. empty ());
+      row. pos = (size_t) pos;
+      replace (row. organism, '_', ' ');
+      rows << std::move (row);
+    }
+    catch (const exception &e)
+    {
+      throw runtime_error ("Reading " + strQuote (fName) + " line:\n" + f. line + "\n" + e. what ());
+    }
+  }
+  return rows;
+}
+
+
+
+Vector<SusceptibleRow> readSusceptibles (const string &fName)
+{
+  Vector<SusceptibleRow> rows;
+  LineInput f (fName);
+  Istringstream iss;
+  while (f. nextLine ())
+  {
+    if (isLeft (f. line, "#"))
+      continue;
+    try
+    {
+      SusceptibleRow row;
+      iss. reset (f. line);
+      iss >> row. organism >> row. genesymbol >> row. accession >> row. cutoff >> row. classS >> row. subclass >> row. name;
+      QC_ASSERT (! row. name. empty ());
+      replace (row. organism, '_', ' ');
+      rows << std::move (row);
+    }
+    catch (const exception &e)
+    {
+      throw runtime_error ("Reading " + strQuote (fName) + " line:\n" + f. line + "\n" + e. what ());
+    }
+  }
+  return rows;
+}
+
+
+
+
+// Table
+
+template <typename Row>
+  void Table<Row>::set (const string &fName,
+                        Vector<Row> &&rows_arg)
+  {
+    name = getFileName (fName);
+    if (! getFileStamp (fName, fileSize, fileTime, fileInode))
+      throw runtime_error ("Cannot get the status of " + shellQuote (fName));
+    rows = std::move (rows_arg);
+  }
+
+
+
+template <typename Row>
+  bool Table<Row>::fresh (const string &fName) const
+  {
+    if (name. empty ())
+      return false;
+    if (name != getFileName (fName))
+      return false;
+    streamsize size = 0;
+    time_t mtime = 0;
+    uint64_t inode = 0;
+    return    getFileStamp (fName, size, mtime, inode)
+           && size  == fileSize
+           && mtime == fileTime
+           && inode == fileInode;
+  }
+
+
+
+template struct Table<FamRow>;
+template struct Table<MutationRow>;
+template struct Table<SusceptibleRow>;
+
+
+
+
+// DbSnapshot
+
+const string DbSnapshot::fName ("AMR.snapshot");
+
+
+
+void DbSnapshot::save (const string &dbDir) const
+{
+  const string tmpFName (dbDir + fName + ".tmp");
+  {
+    ofstream f (tmpFName, ios_base::binary | ios_base::out);
+    if (! f. good ())
+      throw runtime_error ("Cannot create file " + shellQuote (tmpFName));
+    writeStr (f, magic);
+    writeBin (f, version);
+    const auto writeTable = [&f] (const auto &table)
+      { writeStr (f, table. name);
+        writeBin (f, table. fileSize);
+        writeBin (f, table. fileTime);
+        writeBin (f, table. fileInode);
+        ostringstream oss;
+        writeRows (oss, table. rows);
+        writeStr (f, oss. str ());
+      };
+    writeTable (fams);
+    writeTable (mutations);
+    writeTable (susceptibles);
+    writeBin (f, (size_t) dnaMutations. size ());
+    for (const Table<MutationRow>& table : dnaMutations)
+      writeTable (table);
+    if (! f. good ())
+      throw runtime_error ("Cannot write file " + shellQuote (tmpFName));
+  }
+  moveFile (tmpFName, dbDir + fName);
+}
+
+
+
+bool DbSnapshot::load (const string &dbDir,
+                       bool protein,
+                       bool dna)
+{
+  const string fName_ (dbDir + fName);
+  ifstream f (fName_, ios_base::binary | ios_base::in);
+  if (! f. good ())
+    return false;
+    
+  {
+    string magic_;
+    readStr (f, magic_);
+    uint version_ = 0;
+    readBin (f, version_);
+    if (   ! f. good ()
+        || magic_ != magic
+        || version_ != version
+       )
+      return false;
+  }
+
+  const auto readTable = [&f] (auto &table,
+                                bool rowsP)
+    { readStr (f, table. name);
+      readBin (f, table. fileSize);
+      readBin (f, table. fileTime);
+      readBin (f, table. fileInode);
+      if (rowsP)
+      {
+        // Lengths are checked against the table, not the file
+        string s;
+        readStr (f, s);
+        istringstream iss (std::move (s));
+        readRows (iss, table. rows);
+        if (iss. fail ())
+          f. setstate (ios_base::failbit);
+      }
+      else
+      { uint len = 0;
+        readBin (f, len);
+        if (f. good () && (streamsize) len > bytesLeft (f))
+          f. setstate (ios_base::failbit);
+        f. seekg (len, ios_base::cur);
+        table. name. clear ();  // !fresh()
+      }
+    };
+  readTable (fams,         protein);
+  readTable (mutations,    protein);
+  readTable (susceptibles, protein);
+  size_t n = 0;
+  readBin (f, n);
+  if (f. good ())
+  {
+    const streamsize left = bytesLeft (f);
+    if (left < 0 || n > (size_t) left)
+      f. setstate (ios_base::failbit);
+  }
+  if (f. good ())
+  {
+    dnaMutations. resize (n);
+    for (Table<MutationRow>& table : dnaMutations)
+      readTable (table, dna);
+  }
+  if (! f. good ())
+    throw runtime_error ("File " + shellQuote (fName_) + " is corrupt, run amrfinder_index");
+  
+  return true;
+}
+
+
+
+}  // namespace
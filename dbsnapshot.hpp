@@ -0,0 +1,190 @@
+// dbsnapshot.hpp
+
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE                          
+*               National Center for Biotechnology Information
+*                                                                          
+*  This software/database is a "United States Government Work" under the   
+*  terms of the United States Copyright Act.  It was written as part of    
+*  the author's official duties as a United States Government employee and 
+*  thus cannot be copyrighted.  This software/database is freely available 
+*  to the public for use. The National Library of Medicine and the U.S.    
+*  Government have not placed any restriction on its use or reproduction.  
+*                                                                          
+*  Although all reasonable efforts have been taken to ensure the accuracy  
+*  and reliability of the software and data, the NLM and the U.S.          
+*  Government do not and cannot warrant the performance or results that    
+*  may be obtained by using this software or data. The NLM and the U.S.    
+*  Government disclaim all warranties, express or implied, including       
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.                                                                
+*                                                                          
+*  Please cite the author in any work or product based on this material.   
+*
+* ===========================================================================
+*
+* Author: Vyacheslav Brover
+*
+* File Description:
+*   Binary snapshot of the tables of the AMRFinderPlus database
+*
+*/
+
+
+
+#ifndef DBSNAPSHOT_HPP
+#define DBSNAPSHOT_HPP
+
+
+#include "common.hpp"
+using namespace Common_sp;
+
+
+
+namespace DbSnapshot_sp
+{
+
+
+
+// Rows of the database tables
+// Numbers are as in the files, no thresholds are applied
+
+
+struct FamRow
+// fam.tsv
+{
+  string id;
+  size_t parent {no_index};
+    // Index in DbSnapshot::fams
+  string genesymbol;
+  string hmm;
+  double tc1 {0.0};
+  double tc2 {0.0};
+  // BlastRule's, %
+  double complete_ident {0.0};
+  double complete_target_coverage {0.0};
+  double complete_ref_coverage {0.0};
+  double partial_ident {0.0};
+  double partial_target_coverage {0.0};
+  double partial_ref_coverage {0.0};
+  uchar reportable {0};
+  string type;
+  string subtype;
+  string classS;
+  string subclass;
+  string familyName;
+  
+  void save (ostream &os) const;
+  void read (istream &is);
+};
+
+
+
+struct MutationRow
+// AMRProt-mutation.tsv, AMR_DNA-<taxgroup>.tsv
+{
+  string organism;
+    // '_' = ' '
+    // Empty for AMR_DNA-<taxgroup>.tsv
+  string accession;
+  size_t pos {0};
+    // > 0
+  string geneMutation_std;
+  string geneMutation_report;
+  string classS;
+  string subclass;
+  string name;
+
+  void save (ostream &os) const;
+  void read (istream &is);
+};
+
+
+
+struct SusceptibleRow
+// AMRProt-susceptible.tsv
+{
+  string organism;
+    // '_' = ' '
+  string genesymbol;
+  string accession;
+  double cutoff {0.0};
+  string classS;
+  string subclass;
+  string name;
+
+  void save (ostream &os) const;
+  void read (istream &is);
+};
+
+
+
+// Parsing of the tables
+
+Vector<FamRow> readFams (const string &fName);
+  // Invokes: QC of the tree
+
+Vector<MutationRow> readMutations (const string &fName,
+                                   bool organismP);
+  // Input: organismP: the first column is a taxgroup
+
+Vector<SusceptibleRow> readSusceptibles (const string &fName);
+
+
+
+template <typename Row>
+  struct Table
+  // Parsed TSV file of a database directory
+  {
+    string name;
+      // File name without directory
+    // Of the TSV file
+    streamsize fileSize {0};
+    time_t fileTime {0};
+      // Modification time
+    uint64_t fileInode {0};
+    Vector<Row> rows;
+    
+    
+    void set (const string &fName,
+              Vector<Row> &&rows_arg);
+    bool fresh (const string &fName) const;
+      // Return: rows are the rows of fName: the same file name, size, modification time and inode
+  };
+
+
+
+struct DbSnapshot
+// Binary snapshot of the tables of a database directory
+// Made by amrfinder_index
+{
+  static constexpr uint version = 1;
+    // To be increased if the format changes
+  static const string fName;
+    // In the database directory
+
+  Table<FamRow> fams;
+  Table<MutationRow> mutations;
+  Table<SusceptibleRow> susceptibles;
+  Vector<Table<MutationRow>> dnaMutations;
+    // AMR_DNA-<taxgroup>.tsv
+
+
+  void save (const string &dbDir) const;
+  bool load (const string &dbDir,
+             bool protein,
+             bool dna);
+    // Input: protein: load fams, mutations, susceptibles
+    //        dna: load dnaMutations
+    // Return: false if the snapshot file is missing or has a different version
+    // Time: O(size of the loaded tables)
+};
+
+
+
+}  // namespace
+
+
+
+#endif
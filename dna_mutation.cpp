@@ -42,6 +42,8 @@ using namespace Common_sp;
 #include "alignment.hpp"
 using namespace Alignment_sp;
 #include "columns.hpp"
+#include "dbsnapshot.hpp"
+using namespace DbSnapshot_sp;
 
 #include "common.inc"
 
@@ -199,9 +201,20 @@ struct BlastnAlignment final : Alignment
       return false;
     }
 #endif
+
+
+  // Memory
+  static BlockPool pool;
+  static void* operator new (size_t size)
+    { return pool. allocate (size); }
+  static void operator delete (void* p)
+    { pool. deallocate (p); }
 };
 
 
+BlockPool BlastnAlignment::pool (sizeof (BlastnAlignment));
+
+
 
 
 struct Batch
@@ -212,26 +225,28 @@ struct Batch
   explicit Batch (const string &mutation_tab)
 	  {
 	    {
-        LineInput f (mutation_tab);
-   	  	Istringstream iss;
-    	  while (f. nextLine ())
-    	  {
-	  	    if (isLeft (f. line, "#"))
-	  	      continue;
-     	  	iss. reset (f. line);
-    	  	string accession, geneMutation_std, geneMutation_report, classS, subclass, name;
-    			int pos;
-    	  	iss >> accession >> pos >> geneMutation_std >> geneMutation_report >> classS >> subclass >> name;
-    	  	QC_ASSERT (pos > 0);
-    	  	QC_ASSERT (! name. empty ());
-   	  		accession2mutations [accession] << std::move (AmrMutation ((size_t) pos, geneMutation_std, geneMutation_report, classS, subclass, name));
-    	  }	    
+	      Vector<MutationRow> rows;
+	      {
+	        DbSnapshot snapshot;
+	        if (snapshot. load (getDirName (mutation_tab), false, true))
+	          for (Table<MutationRow>& table : snapshot. dnaMutations)
+	            if (table. fresh (mutation_tab))
+	            {
+	              rows = std::move (table. rows);
+	              break;
+	            }
+	      }
+	      if (rows. empty ())
+	        rows = readMutations (mutation_tab, false);
+	      for (const MutationRow& row : rows)
+   	  		accession2mutations [row. accession] << std::move (AmrMutation (row. pos, row. geneMutation_std, row. geneMutation_report, row. classS, row. subclass, row. name));
     	}
   	  for (auto& it : accession2mutations)
   	  {
   	  	it. second. sort ();
   	    if (! it. second. isUniq ())
   	  	  throw runtime_error ("Duplicate reference mutations for " + it. first);
+  	  	sortRefMutations (it. second);
   	  }
 	  }
 	  	  
@@ -317,7 +332,8 @@ struct ThisApplication final : Application
                  print_node         = getFlag ("print_node");
     
 
-    Batch batch (mutation_tab);  
+    // Not freed: the process exits after body()
+    Batch& batch = * new Batch (mutation_tab);  
   
   
     // Input 
@@ -348,31 +364,12 @@ struct ThisApplication final : Application
 		}
 		
     
-    // Group by sseqid and process each sseqid separately for speed ??    
-  //Common_sp::sort (batch. blastAls);
-    for (const BlastnAlignment* blastAl1 : batch. blastAls)
-      for (const SeqChange& seqChange1 : blastAl1->seqChanges)
-      {
-        ASSERT (seqChange1. al == blastAl1);
-      //ASSERT (seqChange1. mutation);
-        for (const BlastnAlignment* blastAl2 : batch. blastAls)
-          if (   blastAl2->sseqid  == blastAl1->sseqid
-              && blastAl2->sInt. strand == blastAl1->sInt. strand
-              && blastAl2 != blastAl1
-             )  
-          //for (Iter<Vector<SeqChange>> iter (var_cast (blastAl2) -> seqChanges); iter. next (); )
-            for (SeqChange& seqChange2 : var_cast (blastAl2) -> seqChanges)
-            {
-            //SeqChange& seqChange2 = *iter;
-              ASSERT (seqChange2. al == blastAl2);
-            //ASSERT (seqChange2. mutation);
-              if (   seqChange1. start_target == seqChange2. start_target 
-                  && seqChange1. better (seqChange2)                
-                 )
-              //iter. erase ();
-                seqChange2. replacement = & seqChange1;
-            }
-      }
+    {
+      SeqChangeIndex seqChangeIndex;
+      for (const BlastnAlignment* blastAl : batch. blastAls)
+        seqChangeIndex. add (* var_cast (blastAl));
+      seqChangeIndex. setReplacements (false);
+    }
 		
   #if 0
   	// [UNKNOWN]
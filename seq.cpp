@@ -36,6 +36,10 @@
 
 #include "seq.hpp"
 
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+
 #include "common.inc"
 
 
@@ -76,6 +80,80 @@ size_t alphabet2Pos (const char* alphabet,
 
 
 
+
+// Aligned sequences
+
+size_t seqMismatch (const string &seq1,
+                    const string &seq2,
+                    size_t start)
+{
+  ASSERT (seq1. size () == seq2. size ());
+  ASSERT (start <= seq1. size ());
+  
+  const size_t size = seq1. size ();
+  const char* a = seq1. data ();
+  const char* b = seq2. data ();
+  size_t i = start;
+#ifdef __SSE2__
+  while (i + 16 <= size)
+  {
+    const __m128i x = _mm_loadu_si128 ((const __m128i*) (a + i));
+    const __m128i y = _mm_loadu_si128 ((const __m128i*) (b + i));
+    const unsigned diff = (unsigned) _mm_movemask_epi8 (_mm_cmpeq_epi8 (x, y)) ^ 0xFFFFu;
+    if (diff)
+      return i + (size_t) __builtin_ctz (diff);
+    i += 16;
+  }
+#else
+  while (i + 8 <= size)
+  {
+    uint64_t x, y;
+    memcpy (& x, a + i, 8);
+    memcpy (& y, b + i, 8);
+    if (x != y)
+      break;  // The mismatch is found below
+    i += 8;
+  }
+#endif
+  while (i < size && a [i] == b [i])
+    i++;
+  return i;
+}
+
+
+
+size_t countChars (const char* s,
+                   size_t len,
+                   const char* charSet)
+{
+  ASSERT (s);
+  ASSERT (charSet);
+  
+  size_t n = 0;
+  size_t i = 0;
+#ifdef __SSE2__
+  const size_t setSize = strlen (charSet);
+  while (i + 16 <= len)
+  {
+    const __m128i x = _mm_loadu_si128 ((const __m128i*) (s + i));
+    __m128i eq = _mm_setzero_si128 ();
+    FFOR (size_t, j, setSize)
+      eq = _mm_or_si128 (eq, _mm_cmpeq_epi8 (x, _mm_set1_epi8 (charSet [j])));
+    n += (size_t) __builtin_popcount ((unsigned) _mm_movemask_epi8 (eq));
+    i += 16;
+  }
+#endif
+  while (i < len)
+  {
+    if (strchr (charSet, s [i]))
+      n++;
+    i++;
+  }
+  return n;
+}
+
+
+
 //////////////////////////////// Seq ////////////////////////////////////
 
 constexpr size_t fastaLineLen = 80;
@@ -1119,15 +1197,14 @@ string& reverseDna (string &seq)
 
 
 
-char codon2aa (const char codon [3],
-               Gencode gencode,
-               bool lowercasePossibleStartCodon)
+namespace
+{
+  
+  
+char codon2aa_switch (const char c [3],
+                      Gencode gencode)
+// Input: c[]: lower-case
 {
-  char c [3];
-  FOR (size_t, i, 3)
-    c [i] = toLower (codon [i]);
-
-
   char aa = 'X';
   switch (c [0])
   {
@@ -1227,27 +1304,107 @@ char codon2aa (const char codon [3],
           charInSet (c [2], "agr"))  aa = 'L';
   }
   ASSERT (charInSet (aa, extTermPeptideAlphabet));
+  return aa;
+}
+
+
+
+bool isStartCodon_switch (const char c [3],
+                          Gencode gencode)
+// Input: c[]: lower-case
+{
+  bool startcodon = false;
+  switch (gencode)
+  {
+    case  1: if (    c[0] == 'a' && c[1] == 't' && c[2] == 'g' )  startcodon = true;
+    Case  4: if (   (               c[1] == 't' && c[2] == 'g')
+                 || (c[0] == 'a' && c[1] == 't'               )
+                 || (c[0] == 't' && c[1] == 't' && c[2] == 'a'))  startcodon = true;
+    Case 11: if (                  (c[1] == 't' && c[2] == 'g')
+                 || (c[0] == 'a' && c[1] == 't')               )  startcodon = true;  
+    Case 25: if (    c[0] != 'c' && c[1] == 't' && c[2] == 'g' )  startcodon = true;
+    Default: throw runtime_error (FUNC "Genetic code " + to_string ((int) gencode) + " is not implemented");
+  }
+  return startcodon;
+}
+
+
+
+struct CodonTable
+// Tabulated codon2aa_switch() and isStartCodon_switch()
+{
+  static constexpr const char* letters {"acgtyrwmhs"};
+    // Letters distinguished by codon2aa_switch() and isStartCodon_switch()
+  static constexpr size_t alphabetSize {10 + 1};
+    // + other
+  static constexpr size_t codes {alphabetSize * alphabetSize * alphabetSize};
+  static constexpr array<Gencode,4> startGencodes {{1, 4, 11, 25}};
+
+  array<unsigned char,256> char2code;
+  array<array<char,codes>,2> aa;
+    // Index: gencode is 4 or 25
+  array<array<bool,codes>,startGencodes. size ()> start;
+    // Index: in startGencodes
+
+  CodonTable ()
+    { char2code. fill (alphabetSize - 1);
+      FFOR (unsigned char, i, alphabetSize - 1)
+      { char2code [(unsigned char) letters [i]]            = i;
+        char2code [(unsigned char) toUpper (letters [i])] = i;
+      }
+      FFOR (size_t, code, codes)
+      { char c [3];
+        size_t rest = code;
+        FOR_REV (size_t, i, 3)
+        { const size_t letter = rest % alphabetSize;
+          c [i] = letter == alphabetSize - 1 ? 'n' : letters [letter];
+          rest /= alphabetSize;
+        }
+        aa [0] [code] = codon2aa_switch (c, 1);
+        aa [1] [code] = codon2aa_switch (c, 4);
+        FFOR (size_t, i, startGencodes. size ())
+          start [i] [code] = isStartCodon_switch (c, startGencodes [i]);
+      }
+    }
+  size_t codon2code (const char codon [3]) const
+    { return   (size_t) char2code [(unsigned char) codon [0]] * alphabetSize * alphabetSize
+             + (size_t) char2code [(unsigned char) codon [1]] * alphabetSize
+             + (size_t) char2code [(unsigned char) codon [2]];
+    }
+};
+
+
+
+const CodonTable& getCodonTable ()
+{
+  static const CodonTable codonTable;
+  return codonTable;
+}
   
   
+}
+
+
+
+char codon2aa (const char codon [3],
+               Gencode gencode,
+               bool lowercasePossibleStartCodon)
+{
+  const CodonTable& table = getCodonTable ();
+  const size_t code = table. codon2code (codon);
+  char aa = table. aa [gencode == 4 || gencode == 25] [code];
+
   if (lowercasePossibleStartCodon)
   {
-    bool startcodon = false;
-    switch (gencode)
-    {
-      case  1: if (    c[0] == 'a' && c[1] == 't' && c[2] == 'g' )  startcodon = true;
-      Case  4: if (   (               c[1] == 't' && c[2] == 'g')
-                   || (c[0] == 'a' && c[1] == 't'               )
-                   || (c[0] == 't' && c[1] == 't' && c[2] == 'a'))  startcodon = true;
-      Case 11: if (                  (c[1] == 't' && c[2] == 'g')
-                   || (c[0] == 'a' && c[1] == 't')               )  startcodon = true;  
-      Case 25: if (    c[0] != 'c' && c[1] == 't' && c[2] == 'g' )  startcodon = true;
-      Default: throw runtime_error (FUNC "Genetic code " + to_string ((int) gencode) + " is not implemented");
-    }
-    if (startcodon)
+    size_t i = 0;
+    while (i < CodonTable::startGencodes. size () && CodonTable::startGencodes [i] != gencode)
+      i++;
+    if (i == CodonTable::startGencodes. size ())
+      throw runtime_error (FUNC "Genetic code " + to_string ((int) gencode) + " is not implemented");
+    if (table. start [i] [code])
       aa = toLower (aa);
   }
 
-
   return aa;
 }
 
@@ -4642,8 +4799,17 @@ Hsp::Hsp (const string &blastLine,
   try
   {
     {
-      istringstream iss (blastLine);
-      iss >> qseqid >> sseqid >> qInt. start >> qInt. stop >> qlen >> sInt. start >> sInt. stop >> slen >> qseq >> sseq;
+      string_view rest (blastLine);
+      qseqid      =                   nextWord (rest);
+      sseqid      =                   nextWord (rest);
+      qInt. start = view2int<size_t> (nextWord (rest));
+      qInt. stop  = view2int<size_t> (nextWord (rest));
+      qlen        = view2int<size_t> (nextWord (rest));
+      sInt. start = view2int<size_t> (nextWord (rest));
+      sInt. stop  = view2int<size_t> (nextWord (rest));
+      slen        = view2int<size_t> (nextWord (rest));
+      qseq        =                   nextWord (rest);
+      sseq        =                   nextWord (rest);
     }
     QC_ASSERT (! sseq. empty ());	
 
@@ -4755,22 +4921,37 @@ void Hsp::finishHsp (bool qStopCodon,
   qx = 0;
   sx = 0;
   QC_ASSERT (sseq. size () == length);
-  FOR (size_t, i, length)
   {
-    if (isAmbig (qseq [i], aProt))
-      qx++;
-    if (isAmbig (sseq [i], aProt))
-      sx++;
-    if (qseq [i] == '-')
+    const char* wildcards = aProt ? peptideWildcards : dnaWildcards;
+    size_t i = 0;
+    for (;;)
     {
-      qgap++;
-      QC_ASSERT (sseq [i] != '-');
-    }
-    else if (sseq [i] == '-')
-      sgap++;
-    else if (charMatch (i))
-      nident++;
-  }  
+      // Identical run
+      const size_t stop = seqMismatch (qseq, sseq, i);
+      if (const size_t len = stop - i)
+      {
+        QC_ASSERT (! countChars (& qseq [i], len, "-"));
+        const size_t x = countChars (& qseq [i], len, wildcards);
+        qx += x;
+        sx += x;
+        nident += len;
+      }
+      if (stop == length)
+        break;
+      i = stop;
+      if (isAmbig (qseq [i], aProt))
+        qx++;
+      if (isAmbig (sseq [i], aProt))
+        sx++;
+      if (qseq [i] == '-')
+        qgap++;
+      else if (sseq [i] == '-')
+        sgap++;
+      else if (charMatch (i))
+        nident++;
+      i++;
+    }  
+  }
 
   sframe = 0;
   if (aProt && ! sProt)
@@ -4778,46 +4959,40 @@ void Hsp::finishHsp (bool qStopCodon,
 
   sInternalStop = aProt && contains (sseq, '*');
 
-  pos2q_. clear ();
-  pos2s_. clear ();
+  runs. clear ();
 
   if (! disrs. empty ())
     return;
     
   
-  pos2q_. reserve (length + 1);
   {
-    size_t j = qInt. start;
-    FFOR (size_t, i, length + 1)
+    size_t q = 0;
+    size_t s = 0;
+    size_t i = 0;
+    while (i < length)
     {
-      ASSERT (j >= qInt. start);
-      ASSERT (j <= qInt. stop);
-      pos2q_ << j;
-      if (qseq [i] != '-')
-        j += a2q;
+      const AlignRun run {i, q, s, qseq [i] == '-', sseq [i] == '-'};
+      size_t stop = i + 1;
+      if (run. qGap || run. sGap)
+        while (   stop < length 
+               && (qseq [stop] == '-') == run. qGap 
+               && (sseq [stop] == '-') == run. sGap
+              )
+          stop++;
+      else
+        stop = min (min (qseq. find ('-', i), sseq. find ('-', i)), length);
+      if (! run. qGap)
+        q += stop - i;
+      if (! run. sGap)
+        s += stop - i;
+      runs << run;
+      i = stop;
     }
-  }
-  pos2q_. ascending = etrue;
-
-  pos2s_. reserve (length + 1);
-  {
+    ASSERT (qInt. start + q * a2q <= qInt. stop);
     ASSERT (sInt. stop);
-    size_t j = (sInt. strand == -1 ? sInt. stop : sInt. start);
-    FFOR (size_t, i, length + 1)
-    {
-      ASSERT (j >= sInt. start);
-      ASSERT (j <= sInt. stop);
-      pos2s_ << j;
-      if (sseq [i] != '-')
-      {
-        if (sInt. strand == -1)  // sInt.strand*a2s: needs int
-          j -= a2s;
-        else
-          j += a2s;
-      }
-    }
+    ASSERT (s * a2s <= sInt. len ());
+    runs << AlignRun {length, q, s, false, false};
   }
-  pos2s_. ascending = (sInt. strand == -1 ? efalse : etrue);  
 }
 
 
@@ -4868,11 +5043,13 @@ bool Hsp::moveDashesRight_ (const string &seq1,
   
   bool changed = false;
   size_t start = no_index;
-  FFOR (size_t, i, seq1. size ())
+  for (size_t i = 0; i < seq1. size (); i++)
     if (start == no_index)
     {
-      if (seq2 [i] == '-')
-        start = i;
+      i = seq2. find ('-', i);
+      if (i == string::npos)
+        break;
+      start = i;
     }
     else
       if (seq2 [i] != '-')
@@ -5039,26 +5216,27 @@ void Hsp::qc () const
     QC_ASSERT (sLen () <= length);	    
 		QC_IMPLY (aProt && ! qProt, qAbsCoverage () % 3 == 0); 
 		QC_IMPLY (aProt && ! sProt, sAbsCoverage () % 3 == 0); 
-    QC_ASSERT (pos2q_. size () == length + 1);
-    QC_ASSERT (pos2s_. size () == length + 1);
-    QC_ASSERT (pos2q_ [0]      == qInt. start);
-    QC_ASSERT (pos2q_ [length] == qInt. stop);
-    QC_ASSERT (pos2s_ [0]      == sInt. realStart ());
-    QC_ASSERT (pos2s_ [length] == sInt. realStop ());
-    QC_ASSERT (pos2q_. ascending == etrue);
-    QC_ASSERT (pos2s_. ascending != enull);
-    FOR (size_t, i, length)
+    QC_ASSERT (runs. size () >= 2);
+    QC_ASSERT (runs. front (). pos == 0);
+    QC_ASSERT (runs. front (). q == 0);
+    QC_ASSERT (runs. front (). s == 0);
+    QC_ASSERT (runs. back (). pos == length);
+    QC_ASSERT (qInt. start + runs. back (). q * a2q == qInt. stop);
+    QC_ASSERT (runs. back (). s * a2s == sInt. len ());
+    FFOR_START (size_t, i, 1, runs. size ())
     {
-      QC_ASSERT                             (pos2q_ [i] <= pos2q_ [i + 1]);
-      QC_IMPLY (pos2s_. ascending == etrue,  pos2s_ [i] <= pos2s_ [i + 1]);
-      QC_IMPLY (pos2s_. ascending == efalse, pos2s_ [i] >= pos2s_ [i + 1]);
+      const AlignRun& prev = runs [i - 1];
+      const AlignRun& run  = runs [i];
+      QC_ASSERT (prev. pos < run. pos);
+      QC_ASSERT (prev. q + (prev. qGap ? 0 : run. pos - prev. pos) == run. q);
+      QC_ASSERT (prev. s + (prev. sGap ? 0 : run. pos - prev. pos) == run. s);
+      QC_IMPLY (i + 1 < runs. size (), prev. qGap != run. qGap || prev. sGap != run. sGap);
     }
   }
   else
   {
     QC_ASSERT (merged);
-    QC_ASSERT (pos2q_. empty ());
-    QC_ASSERT (pos2s_. empty ());
+    QC_ASSERT (runs. empty ());
   //const Disruption* prev = nullptr;
     for (const Disruption& disr : disrs)
     {
@@ -5182,11 +5360,25 @@ size_t Hsp::pos2real_s (size_t pos,
 
 
 
+const Hsp::AlignRun& Hsp::pos2run (size_t pos) const
+{
+  ASSERT (runs. size () >= 2);
+  ASSERT (pos <= length);
+  
+  const auto it = std::upper_bound (runs. begin (), runs. end (), pos, [] (size_t pos_, const AlignRun &run) { return pos_ < run. pos; });
+  ASSERT (it != runs. begin ());
+  return *(it - 1);
+}
+
+
+
 size_t Hsp::pos2q (size_t pos,
                    bool forward) const
 { 
   ASSERT (disrs. empty ());
-  return pos2q_ [pos2real_q (pos, forward)]; 
+  pos = pos2real_q (pos, forward);
+  const AlignRun& run = pos2run (pos);
+  return qInt. start + (run. q + (run. qGap ? 0 : pos - run. pos)) * a2q;
 }
 
 
@@ -5195,7 +5387,10 @@ size_t Hsp::pos2s (size_t pos,
                    bool forward) const
 { 
   ASSERT (disrs. empty ());
-  return pos2s_ [pos2real_s (pos, forward)]; 
+  pos = pos2real_s (pos, forward);
+  const AlignRun& run = pos2run (pos);
+  const size_t s = (run. s + (run. sGap ? 0 : pos - run. pos)) * a2s;
+  return sInt. strand == -1 ? sInt. stop - s : sInt. start + s;
 }
 
 
@@ -5204,7 +5399,17 @@ size_t Hsp::q2pos (size_t qPos,
                    bool forward) const
 { 
   ASSERT (disrs. empty ());
-  return pos2real_q (pos2q_. binSearch (qPos), forward); 
+  ASSERT (runs. size () >= 2);
+  ASSERT (qPos >= qInt. start);
+  ASSERT ((qPos - qInt. start) % a2q == 0);
+  
+  const size_t q = (qPos - qInt. start) / a2q;
+  ASSERT (q <= runs. back (). q);
+  const auto it = std::upper_bound (runs. begin (), runs. end (), q, [] (size_t q_, const AlignRun &run) { return q_ < run. q; });
+  ASSERT (it != runs. begin ());
+  const AlignRun& run = *(it - 1);
+  ASSERT (run. pos == length || ! run. qGap);
+  return pos2real_q (run. pos + (q - run. q), forward); 
 }
 
 
@@ -5213,7 +5418,18 @@ size_t Hsp::s2pos (size_t sPos,
                    bool forward) const
 { 
   ASSERT (disrs. empty ());
-  return pos2real_s (pos2s_. binSearch (sPos), forward); 
+  ASSERT (runs. size () >= 2);
+  ASSERT (betweenEqual (sPos, sInt. start, sInt. stop));
+  
+  const size_t sDiff = sInt. strand == -1 ? sInt. stop - sPos : sPos - sInt. start;
+  ASSERT (sDiff % a2s == 0);
+  const size_t s = sDiff / a2s;
+  ASSERT (s <= runs. back (). s);
+  const auto it = std::upper_bound (runs. begin (), runs. end (), s, [] (size_t s_, const AlignRun &run) { return s_ < run. s; });
+  ASSERT (it != runs. begin ());
+  const AlignRun& run = *(it - 1);
+  ASSERT (run. pos == length || ! run. sGap);
+  return pos2real_s (run. pos + (s - run. s), forward); 
 }
 
 
@@ -170,6 +170,23 @@ inline bool isAmbig (char c,
   { return aa ? isAmbigAa (c) : isAmbigNucl (c); }
 
 
+
+// Aligned sequences
+// Vectorized: SSE2 on x86-64, 8-byte words otherwise
+
+size_t seqMismatch (const string &seq1,
+                    const string &seq2,
+                    size_t start);
+  // Return: min i >= start such that seq1[i] != seq2[i]; seq1.size() if none
+  // Requires: seq1.size() == seq2.size(), start <= seq1.size()
+
+size_t countChars (const char* s,
+                   size_t len,
+                   const char* charSet);
+  // Return: number of i < len such that s[i] is in charSet[]
+  // Requires: s[0..len) has no '\0'
+
+
 typedef  unsigned char  Gencode;
   // NCBI genetic code
   
@@ -1297,6 +1314,87 @@ struct Interval : Root
 
 
 
+template <typename T>
+struct IntervalIndex
+// Static index of Interval's with values
+// Implicit balanced binary tree over the Interval's sorted by start, augmented by the maximum stop of a subtree
+{
+private:
+  struct Item
+  {
+    Interval interval;
+    T value;
+    size_t stop_max {0};
+      // Of the subtree rooted at this Item
+  };
+  Vector<Item> items;
+  bool finished {false};
+public:
+
+
+  void add (const Interval &interval,
+            const T &value)
+    { if (finished)
+        throwf ("IntervalIndex::add() after finish()");
+      items << Item {interval, value, 0};
+    }
+  void finish ()
+    // Time: O(n log n)
+    { items. sort ([] (const Item &a, const Item &b) { return a. interval. start < b. interval. start; });
+      setStopMax (0, items. size ());
+      finished = true;
+    }
+  size_t size () const
+    { return items. size (); }
+  template <typename Func/*void (const T &value)*/>
+    void query (const Interval &interval,
+                size_t slack,
+                const Func &func) const
+    // Invokes: func(value) for the Item's of interval.strand which intersect with interval extended by slack at both ends
+    // Time: O(log n + output)
+    { if (! finished)
+        throwf ("IntervalIndex::query() before finish()");
+      query (interval. start > slack ? interval. start - slack : 0, interval. stop + slack, interval. strand, func, 0, items. size ());
+    }
+private:
+  size_t setStopMax (size_t lo,
+                     size_t hi)
+    // Return: stop_max of the subtree [lo,hi)
+    { if (lo >= hi)
+        return 0;
+      const size_t mid = (lo + hi) / 2;
+      Item& item = items [mid];
+      item. stop_max = item. interval. stop;
+      maximize (item. stop_max, setStopMax (lo, mid));
+      maximize (item. stop_max, setStopMax (mid + 1, hi));
+      return item. stop_max;
+    }
+  template <typename Func>
+    void query (size_t start,
+                size_t stop,
+                Strand strand,
+                const Func &func,
+                size_t lo,
+                size_t hi) const
+    { if (lo >= hi)
+        return;
+      const size_t mid = (lo + hi) / 2;
+      const Item& item = items [mid];
+      if (item. stop_max <= start)
+        return;
+      query (start, stop, strand, func, lo, mid);
+      if (item. interval. start >= stop)
+        return;
+      if (   item. interval. strand == strand
+          && item. interval. stop > start
+         )
+        func (item. value);
+      query (start, stop, strand, func, mid + 1, hi);
+    }
+};
+
+
+
 struct Hsp;
 
 
@@ -1415,12 +1513,22 @@ struct Hsp : Root
   size_t qx {no_index}, sx {no_index};  
     // 
 private:
-  // size() = length + 1
-  // [0] = start, [length] = end
-  // strand = 1 <=> [i] <= [i+1]
-  // Require: disrs.empty()
-  Vector<size_t> pos2q_;
-  Vector<size_t> pos2s_;
+  struct AlignRun
+  // Maximal run of alignment columns with the same gap pattern
+  {
+    size_t pos {0};
+      // In alignment
+    size_t q {0};
+    size_t s {0};
+      // Number of non-'-' in qseq/sseq before pos
+    bool qGap {false};
+    bool sGap {false};
+  };
+  Vector<AlignRun> runs;
+    // Ordered by pos, q, s
+    // [0].pos = 0, back().pos = length: sentinel
+    // Require: disrs.empty()
+    // Coordinate maps of pos2q(), pos2s(), q2pos(), s2pos()
 public:
   //
   Frame sframe {0};
@@ -1549,6 +1657,12 @@ public:
                 bool forward) const;
   size_t s2pos (size_t sPos,
                 bool forward) const;
+    // Return: position of the residue starting at qPos/sPos; length if qPos/sPos is the end
+    // Time: O(log(runs.size()))
+private:
+  const AlignRun& pos2run (size_t pos) const;
+    // Return: last AlignRun with pos <= pos
+public:
     
   bool charMatch (size_t pos) const
     { return aProt
@@ -0,0 +1,81 @@
+#!/bin/bash
+
+# Differential test of the Pareto-better filtering of BLAST hits in amr_report:
+# the hits grouped by protein and locus vs. the original quadratic algorithm (-pareto_ungrouped)
+# on random data made by blast_random
+
+seeds=20
+print_help=0
+while getopts "s:h" opt; do
+    case $opt in
+        s) seeds=$OPTARG ;;
+        h) print_help=1 ;;
+    esac
+done
+
+if [ "$print_help" -gt 0 ]
+then
+    echo "test_pareto.sh - Compare grouped and original Pareto-better filtering of amr_report on random data"
+    echo "Options: "
+    echo "    -s <number of random data sets>, default $seeds"
+    echo "    -h print this help message"
+    exit 1
+fi
+
+# some color macros
+if [ "$TERM" == "" ] || [ "$TERM" == "dumb" ] || [ ! -t 1 ]
+then
+    green='' # no colors
+    red=''
+    reset=''
+else
+    green=`tput setaf 2`  # Set green foreground color (code 2)
+    red=`tput setaf 1`    # Set red foreground color (code 1)
+    reset=`tput sgr0`     # Reset color to default
+fi
+
+TMP=`mktemp -d`
+trap "rm -rf $TMP" EXIT
+
+TESTS=0
+FAILURES=0
+
+function run {
+    local tag=$1
+    shift
+    TESTS=$(( $TESTS + 1 ))
+    if ! ./amr_report -fam $TMP/fam.tsv -organism Escherichia -mutation $TMP/mutation.tsv -susceptible $TMP/susceptible.tsv \
+           -mutation_all $TMP/mutation_all -print_node -non_reportable -qc "$@" > $TMP/out 2> $TMP/err \
+       || ! ./amr_report -fam $TMP/fam.tsv -organism Escherichia -mutation $TMP/mutation.tsv -susceptible $TMP/susceptible.tsv \
+           -mutation_all $TMP/mutation_all.ungrouped -print_node -non_reportable -qc -pareto_ungrouped "$@" > $TMP/out.ungrouped 2>> $TMP/err
+    then
+        echo "${red}not ok: amr_report failed on seed $seed $tag${reset}"
+        cat $TMP/err
+        FAILURES=$(( $FAILURES + 1 ))
+    elif ! diff $TMP/out $TMP/out.ungrouped || ! diff $TMP/mutation_all $TMP/mutation_all.ungrouped
+    then
+        echo "${red}not ok: grouped and ungrouped reports differ on seed $seed $tag${reset}"
+        FAILURES=$(( $FAILURES + 1 ))
+    fi
+}
+
+for seed in `seq 1 $seeds`
+do
+    # Few contigs: many close genes
+    ./blast_random $TMP -seed $seed -families $(( 3 + $seed % 10 )) -proteins $(( 20 + 10 * $seed )) -contigs $(( 1 + $seed % 4 ))
+    # Low coverage: short alignments reach the Pareto-better filtering
+    for coverage in 0.5 0.1
+    do
+        run "blastp, blastx, gff, coverage $coverage" -coverage_min $coverage -blastp $TMP/blastp -blastx $TMP/blastx -gff $TMP/gff -dna_len $TMP/len
+        run "blastp, coverage $coverage"              -coverage_min $coverage -blastp $TMP/blastp
+        run "blastx, coverage $coverage"              -coverage_min $coverage -blastx $TMP/blastx -dna_len $TMP/len
+    done
+done
+
+if [ "$FAILURES" -eq 0 ]
+then
+    echo "${green}All $TESTS Pareto-better tests passed${reset}"
+else
+    echo "${red}$FAILURES out of $TESTS Pareto-better tests failed${reset}"
+fi
+exit $FAILURES
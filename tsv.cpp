@@ -259,6 +259,9 @@ TextTable::TextTable (const string &tableFName,
 
 void TextTable::setHeader ()
 {
+  for (Header& h : header)
+    h = std::move (Header (h. name));
+
   RowNum row_num = 0;
   for (const StringVector& row : rows)
   {
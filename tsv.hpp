@@ -193,9 +193,9 @@ struct TextTable : Named
     : pound (pound_arg)
     , header (header_arg)
     {}
-private:
   void setHeader ();
-public:
+    // Input: rows
+    // Output: Header's except name
   static Vector<Header> str2header (const string &s,
                                     char sep = ',')
     { const StringVector vec (s, sep, true);
@@ -322,6 +322,9 @@ public:
 struct TsvOut
 {
 private:
+  TextTable* tab {nullptr};
+  ostringstream tabField;
+  StringVector tabRow;
   ostream* os {nullptr};
   unique_ptr<const ONumber> on;
   size_t lines {0};
@@ -343,6 +346,17 @@ public:
 	                 bool scientific = false)
 	  : TsvOut (& os_arg, precision, scientific)
 	  {}
+  explicit TsvOut (TextTable &tab_arg,
+                   streamsize precision = 6,
+	                 bool scientific = false)
+	  : tab (& tab_arg)
+	  , os (& tabField)
+	  , on (new ONumber (tabField, precision, scientific))
+	  { tab->header. clear ();
+	    tab->rows. clear ();
+	  }
+	  // Output: tab_arg: header, rows
+	  //           Invoke tab_arg.setHeader() after the last newLn()
  ~TsvOut ()
     { if (fields)
         errorExitStr ("TsvOut: unfinished line with " + to_string (fields) + " fields"); 
@@ -361,11 +375,20 @@ public:
       { if (os)
         { if (lines && fields >= fields_max)
             throw runtime_error ("TsvOut: fields_max = " + to_string (fields_max));
-          if (fields)  
-            *os << '\t'; 
-          else if (! lines && usePound)
-            *os << '#';
-          *os << field; 
+          if (tab)
+          { tabField. str (noString);
+            tabField << field;
+            string s (tabField. str ());
+            trim (s);
+            tabRow << std::move (s);
+          }
+          else
+          { if (fields)  
+              *os << '\t'; 
+            else if (! lines && usePound)
+              *os << '#';
+            *os << field; 
+          }
           fields++;
         }
         return *this; 
@@ -373,7 +396,18 @@ public:
   void newLn ()
     { if (! os)
         return;
-      *os << endl;
+      if (tab)
+      { if (lines)
+          tab->rows << std::move (tabRow);
+        else
+        { tab->pound = usePound;
+          for (string& name : tabRow)
+            tab->header << std::move (TextTable::Header (std::move (name)));
+        }
+        tabRow. clear ();
+      }
+      else
+        *os << endl;
       if (! lines)
         fields_max = fields;
       lines++;